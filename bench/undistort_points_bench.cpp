@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/undistortion.h"
+#include "camera_calibration/undistortion_kernel.h"
+
+using namespace camera_calibration;
+
+namespace {
+
+
+const cv::Size kImageSize { 1920, 1080 };
+
+
+CameraParameters MakeCameraParameters(bool rational_model)
+{
+	cv::Mat camera_matrix { cv::Mat::eye(3, 3, CV_64F) };
+	camera_matrix.at<double>(0, 0) = 1405.0;
+	camera_matrix.at<double>(1, 1) = 1398.0;
+	camera_matrix.at<double>(0, 2) = 962.5;
+	camera_matrix.at<double>(1, 2) = 537.0;
+
+	cv::Mat distortion_coefficients { cv::Mat::zeros(rational_model ? 8 : 5, 1, CV_64F) };
+	distortion_coefficients.at<double>(0) = rational_model ? 0.15 : -0.24;
+	distortion_coefficients.at<double>(1) = rational_model ? -0.05 : 0.09;
+	distortion_coefficients.at<double>(2) = 4e-4;
+	distortion_coefficients.at<double>(3) = -7e-4;
+	distortion_coefficients.at<double>(4) = rational_model ? 0.0 : -0.02;
+	if (rational_model) {
+		distortion_coefficients.at<double>(5) = 0.38;
+		distortion_coefficients.at<double>(6) = -0.03;
+	}
+
+	CameraParameters camera_parameters;
+	camera_parameters.SetCameraMatrix(camera_matrix);
+	camera_parameters.SetDistrotionCoefficients(distortion_coefficients);
+	camera_parameters.SetImageSize(kImageSize);
+	return camera_parameters;
+}
+
+
+// Best wall time of `repetitions` runs in milliseconds.
+double MeasureMilliseconds(int repetitions, const std::function<void()>& run)
+{
+	double best_time { 0.0 };
+	for (int repetition = 0; repetition < repetitions; ++repetition) {
+		auto start = std::chrono::steady_clock::now();
+		run();
+		auto stop = std::chrono::steady_clock::now();
+		double time = std::chrono::duration<double, std::milli>(stop - start).count();
+		best_time = repetition == 0 ? time : std::min(best_time, time);
+	}
+	return best_time;
+}
+
+
+double GetMaxDeviation(const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& reference_points, double focal_length)
+{
+	double max_deviation { 0.0 };
+	for (size_t i = 0; i < points.size(); ++i) {
+		double dx { static_cast<double>(points[i].x) - reference_points[i].x };
+		double dy { static_cast<double>(points[i].y) - reference_points[i].y };
+		max_deviation = std::max(max_deviation, std::sqrt(dx * dx + dy * dy) * focal_length);
+	}
+	return max_deviation;
+}
+
+
+void PrintResult(const std::string& name, double time, double reference_time, size_t point_count, double deviation)
+{
+	std::cout << "   " << std::left << std::setw(34) << name << std::right
+		<< std::fixed << std::setprecision(3) << std::setw(10) << time << " ms"
+		<< std::setprecision(1) << std::setw(9) << point_count / time / 1000.0 << " Mpt/s"
+		<< std::setprecision(2) << std::setw(8) << reference_time / time << "x"
+		<< std::scientific << std::setprecision(2) << std::setw(12) << deviation << " px" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+
+void RunBenchmark(bool rational_model, size_t point_count, int repetitions)
+{
+	CameraParameters camera_parameters { MakeCameraParameters(rational_model) };
+	const double focal_length { camera_parameters.GetCameraMatrix().at<double>(0, 0) };
+
+	cv::RNG rng(0x5eed);
+	std::vector<cv::Point2f> points(point_count);
+	for (auto& point : points) {
+		point.x = rng.uniform(0.0f, kImageSize.width - 1.0f);
+		point.y = rng.uniform(0.0f, kImageSize.height - 1.0f);
+	}
+
+	std::cout << " - " << (rational_model ? "rational" : "standard") << " model, " << point_count << " points:" << std::endl;
+
+	std::vector<cv::Point2f> reference_points;
+	double reference_time { MeasureMilliseconds(repetitions, [&] {
+		cv::undistortPoints(points, reference_points, camera_parameters.GetCameraMatrix(), camera_parameters.GetDistrotionCoefficients());
+	}) };
+	PrintResult("cv::undistortPoints", reference_time, reference_time, point_count, 0.0);
+
+	std::vector<cv::Point2f> undistorted_points(point_count);
+	double time { MeasureMilliseconds(repetitions, [&] {
+		UndistortPoints(points.data(), undistorted_points.data(), point_count, camera_parameters);
+	}) };
+	PrintResult("UndistortPoints", time, reference_time, point_count, GetMaxDeviation(undistorted_points, reference_points, focal_length));
+
+	time = MeasureMilliseconds(repetitions, [&] {
+		UndistortPointsVectorized(points.data(), undistorted_points.data(), point_count, camera_parameters);
+	});
+	PrintResult("UndistortPointsVectorized", time, reference_time, point_count, GetMaxDeviation(undistorted_points, reference_points, focal_length));
+
+	time = MeasureMilliseconds(repetitions, [&] {
+		UndistortPointsVectorized(points.data(), undistorted_points.data(), point_count, camera_parameters, 5, 1e-6f);
+	});
+	PrintResult("UndistortPointsVectorized, eps 1e-6", time, reference_time, point_count,
+		GetMaxDeviation(undistorted_points, reference_points, focal_length));
+
+	FitInverseDistortionModel(camera_parameters, kImageSize);
+	time = MeasureMilliseconds(repetitions, [&] {
+		UndistortPointsClosedForm(points.data(), undistorted_points.data(), point_count, camera_parameters);
+	});
+	PrintResult("UndistortPointsClosedForm", time, reference_time, point_count, GetMaxDeviation(undistorted_points, reference_points, focal_length));
+
+	UndistortionLut lut(camera_parameters, kImageSize);
+	time = MeasureMilliseconds(repetitions, [&] {
+		lut.Undistort(points.data(), undistorted_points.data(), point_count);
+	});
+	PrintResult("UndistortionLut, pitch 8", time, reference_time, point_count, GetMaxDeviation(undistorted_points, reference_points, focal_length));
+}
+
+
+} // namespace
+
+
+// undistort_points_bench [point count] [repetitions]
+// Times point undistortion against cv::undistortPoints on the same camera and reports
+// the max deviation from it in pixels. Accuracy is checked by test/undistortion_test.
+int main(int argc, char** argv)
+{
+	size_t point_count { argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 1000000 };
+	int repetitions { argc > 2 ? std::max(1, std::atoi(argv[2])) : 10 };
+
+	std::cout << " - Undistortion kernel: " << GetUndistortionKernelName() << std::endl;
+
+	RunBenchmark(false, point_count, repetitions);
+	RunBenchmark(true, point_count, repetitions);
+
+	return 0;
+}
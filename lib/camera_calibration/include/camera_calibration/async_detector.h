@@ -0,0 +1,100 @@
+#ifndef CAMERA_CALIBRATION_ASYNC_DETECTOR_H_
+#define CAMERA_CALIBRATION_ASYNC_DETECTOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/chessboard_tracker.h"
+#include "camera_calibration/image_quality.h"
+
+namespace camera_calibration {
+
+
+// Chessboard detection on a worker thread for live streams. Submit never blocks: a
+// frame that is still waiting when a newer one arrives is dropped, so the worker
+// always picks up the most recent frame and the caller's loop runs at its own rate.
+// The caller reads back the latest finished detection with GetLatestResult. With
+// use_corner_tracking the board found on one frame is tracked into the next instead of
+// being detected again (see ChessboardTracker). With use_quality_filter, blurry and
+// badly exposed frames are rejected before detection, and with a duplicate hash
+// distance a frame that duplicates the last detected one reuses its result.
+class AsyncChessboardDetector final
+{
+public:
+
+    struct Result
+    {
+        bool pattern_found { false };
+        // True if the corners were tracked from the previous frame, not fully detected.
+        bool tracked { false };
+        // True if the board was found in a crop around its last position.
+        bool found_in_region { false };
+        // Why the quality filter rejected the frame; DUPLICATE results repeat the last
+        // detection, including its grayscale frame.
+        ImageQualityIssue quality_issue { ImageQualityIssue::NONE };
+        uint64_t frame_id { 0 };
+        // Grayscale frame the corners were found on, kept for sub-pixel refinement.
+        cv::Mat image_gray;
+        std::vector<cv::Point2f> corners;
+    };
+
+    explicit AsyncChessboardDetector(const CameraCalibrationSettings& calibration_settings);
+    ~AsyncChessboardDetector();
+
+    AsyncChessboardDetector(const AsyncChessboardDetector&) = delete;
+    AsyncChessboardDetector& operator=(const AsyncChessboardDetector&) = delete;
+
+    // Hands a BGR or grayscale frame to the worker. A BGR frame is converted to
+    // grayscale before Submit returns, a grayscale frame is copied, so the caller may
+    // reuse its buffer right away.
+    void Submit(const cv::Mat& image, uint64_t frame_id);
+    // Returns false until the first detection has finished.
+    bool GetLatestResult(Result& result) const;
+
+    size_t GetProcessedFrameCount() const;
+    size_t GetSkippedFrameCount() const;
+    size_t GetTrackedFrameCount() const;
+    size_t GetRegionDetectedFrameCount() const;
+    // Frames rejected as blurry or badly exposed.
+    size_t GetRejectedFrameCount() const;
+    // Frames that reused the last detection as duplicates.
+    size_t GetDuplicateFrameCount() const;
+
+private:
+
+    CameraCalibrationSettings calibration_settings_;
+    // Used by the worker thread only.
+    ChessboardTracker tracker_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_available_;
+    cv::Mat pending_image_;
+    uint64_t pending_frame_id_ { 0 };
+    bool has_pending_frame_ { false };
+    bool stop_ { false };
+
+    Result latest_result_;
+    bool has_result_ { false };
+    size_t processed_frame_count_ { 0 };
+    size_t skipped_frame_count_ { 0 };
+    size_t tracked_frame_count_ { 0 };
+    size_t region_detected_frame_count_ { 0 };
+    size_t rejected_frame_count_ { 0 };
+    size_t duplicate_frame_count_ { 0 };
+
+    std::thread worker_;
+
+    void Run();
+    void Detect(Result& result);
+};
+
+
+} // namespace camera_calibration
+
+#endif
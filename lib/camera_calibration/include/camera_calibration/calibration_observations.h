@@ -0,0 +1,53 @@
+#ifndef CAMERA_CALIBRATION_CALIBRATION_OBSERVATIONS_H_
+#define CAMERA_CALIBRATION_CALIBRATION_OBSERVATIONS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/corner_dataset.h"
+
+namespace camera_calibration {
+
+
+// Input of the calibration: one board model shared by all views plus the detected
+// corners of every view in a single corner dataset. Corner i of the dataset is the
+// image of board point GetBoardIndex(i). A view may see only part of the board.
+class CalibrationObservations final
+{
+public:
+
+    CalibrationObservations() = default;
+    explicit CalibrationObservations(const std::vector<cv::Point3f>& board_points);
+
+    const std::vector<cv::Point3f>& GetBoardPoints() const { return board_points_; }
+    const CornerDataset& GetCorners() const { return corners_; }
+
+    size_t GetViewCount() const { return corners_.GetViewCount(); }
+    // True if the view sees every board point in board order and all its corners are valid.
+    bool IsViewComplete(size_t view) const { return view_complete_[view] != 0; }
+
+    // Board points and image points of the valid corners of a view.
+    void GetViewPoints(size_t view, std::vector<cv::Point3f>& object_points, std::vector<cv::Point2f>& image_points) const;
+
+    // Adds a view that sees the whole board, corners in board order.
+    void AddView(const std::vector<cv::Point2f>& corners);
+    // Adds view `view` of a dataset, keeping its board indices, weights and flags.
+    void AddView(const CornerDataset& dataset, size_t view);
+
+    void Reserve(size_t view_count);
+
+private:
+
+    std::vector<cv::Point3f> board_points_;
+    CornerDataset corners_;
+    std::vector<char> view_complete_;
+
+    void UpdateViewState(size_t view);
+};
+
+
+} // namespace camera_calibration
+
+#endif
@@ -1,10 +1,19 @@
 #ifndef CAMERA_CALIBRATION_H_
 #define CAMERA_CALIBRATION_H_
 
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
 #include <opencv2/calib3d.hpp>
 
 #include "nlohmann/json.hpp"
 
+#include "camera_calibration/calibration_observations.h"
+#include "camera_calibration/corner_dataset.h"
+
 namespace camera_calibration {
 
 
@@ -24,6 +33,64 @@ private:
 };
 
 
+enum class CameraParametersFileFormat
+{
+    TEXT,
+    BINARY
+};
+
+
+// Backend used by CameraCalibration::Solve. OPENCV runs cv::calibrateCamera, SPARSE
+// runs CalibrateCameraSparse (see sparse_calibration.h), which scales linearly in the
+// number of views. OPENCV is the default under every performance profile, SPARSE is
+// only used when the settings select it.
+enum class CalibrationSolver
+{
+    OPENCV,
+    SPARSE
+};
+
+
+// Distortion coefficients estimated by the solver. REDUCED is k1, k2, p1, p2 (k3 stays
+// zero), STANDARD adds k3, RATIONAL adds k4..k6 (cv::CALIB_RATIONAL_MODEL) and is only
+// supported by the OPENCV solver.
+enum class DistortionModel
+{
+    REDUCED,
+    STANDARD,
+    RATIONAL
+};
+
+
+// Presets for the knobs that trade accuracy for speed: the detection cascade, the
+// sub-pixel window cap and criteria, the distortion model and the solver criteria
+// (see CameraCalibrationSettings::SetPerformanceProfile). BALANCED holds the defaults.
+enum class PerformanceProfile
+{
+    FAST,
+    BALANCED,
+    ACCURATE
+};
+
+
+// Stages of the chessboard detection cascade, run in the configured order until one
+// finds the board (see FindChessboardCornersCoarseToFine). FAST_CHECK is a gate: the
+// quick test behind CALIB_CB_FAST_CHECK, which ends the cascade when it sees no board.
+// It also rejects some low-contrast boards the later stages find, so only the FAST
+// profile uses it.
+// PLAIN uses a global threshold only, ADAPTIVE adds adaptive thresholding and image
+// normalization (the detection flags used before the cascade existed), FILTER_QUADS
+// adds quad filtering, EQUALIZED retries with FILTER_QUADS on a locally equalized image.
+enum class DetectionStage
+{
+    FAST_CHECK,
+    PLAIN,
+    ADAPTIVE,
+    FILTER_QUADS,
+    EQUALIZED
+};
+
+
 class CameraParameters
 {
 public:
@@ -32,13 +99,30 @@ public:
     cv::Mat GetDistrotionCoefficients() const;
     std::vector<cv::Mat> GetRotationVectors() const;
     std::vector<cv::Mat> GetTranslationVectors() const;
+    cv::Size GetImageSize() const;
+    double GetReprojectionError() const;
+    cv::Mat GetInverseDistortionCoefficients() const;
+    double GetInverseDistortionMaxError() const;
+    double GetInverseDistortionRmsError() const;
 
     void SetCameraMatrix(const cv::Mat&);
     void SetDistrotionCoefficients(const cv::Mat&);
     void SetRotationVectors(const std::vector<cv::Mat>&);
     void SetTranslationVectors(const std::vector<cv::Mat>&);
-
-    bool SaveToFile(const std::string& filename) const;
+    void SetImageSize(const cv::Size&);
+    void SetReprojectionError(const double&);
+    void SetInverseDistortionCoefficients(const cv::Mat&);
+    void SetInverseDistortionMaxError(const double&);
+    void SetInverseDistortionRmsError(const double&);
+
+    // cv::getOptimalNewCameraMatrix with alpha = 1, computed once per image size.
+    cv::Mat GetOptimalNewCameraMatrix(const cv::Size& image_size) const;
+
+    // The text format holds the camera matrix, the distortion coefficients and the
+    // inverse distortion model, the binary format (see camera_parameters_binary.h)
+    // holds all parameters.
+    // LoadFromFile detects the format from the file contents.
+    bool SaveToFile(const std::string& filename, CameraParametersFileFormat format = CameraParametersFileFormat::TEXT) const;
     bool LoadFromFile(const std::string& filename);
 
     friend class CameraCalibration;
@@ -49,6 +133,24 @@ private:
     cv::Mat distortion_coefficients_;
     std::vector<cv::Mat> rotation_vectors_;
     std::vector<cv::Mat> translation_vectors_;
+    cv::Size image_size_;
+    double reprojection_error_ { 0.0 };
+
+    // Closed-form inverse of the distortion model (see FitInverseDistortionModel),
+    // with its fit residual in pixels.
+    cv::Mat inverse_distortion_coefficients_;
+    double inverse_distortion_max_error_ { 0.0 };
+    double inverse_distortion_rms_error_ { 0.0 };
+
+    struct OptimalCameraMatrixCache
+    {
+        std::mutex mutex;
+        std::map<std::pair<int, int>, cv::Mat> matrices;
+    };
+
+    // Shared between copies; replaced whenever the intrinsics change.
+    std::shared_ptr<OptimalCameraMatrixCache> optimal_camera_matrix_cache_ { 
+        std::make_shared<OptimalCameraMatrixCache>() };
 };
 
 
@@ -76,6 +178,40 @@ public:
     std::string GetImageSourceType() const;
     std::string GetImageSourcePath() const;
     std::string GetCameraParametersFilePath() const;
+    CameraParametersFileFormat GetCameraParametersFileFormat() const;
+    int GetThreadCount() const;
+    int GetDecodeScale() const;
+    bool GetUseDetectionCache() const;
+    bool GetUseCornerTracking() const;
+    int GetExpectedSquareSize() const;
+    std::vector<DetectionStage> GetDetectionCascade() const;
+    // Rejects blurry and badly exposed images before detection (see ImageQuality); off
+    // by default, since the sharpness and clipping thresholds are not tuned for every
+    // camera.
+    bool GetUseQualityFilter() const;
+    double GetMinSharpness() const;
+    double GetMaxClippedFraction() const;
+    // Hash distance below which two images count as duplicates; 0 (the default) turns
+    // duplicate detection off, since views of a board tilted in place hash alike.
+    int GetDuplicateHashDistance() const;
+    CalibrationSolver GetCalibrationSolver() const;
+    cv::TermCriteria GetAccuracyCriteria() const;
+    // Half size of the cornerSubPix window; 0 x 0 derives it from the corner spacing of
+    // each view (see GetRefinementWindowSize), capped at GetMaxSearchWindowSize.
+    cv::Size GetSearchWindowSize() const;
+    int GetMaxSearchWindowSize() const;
+    cv::Size GetZeroZoneSize() const;
+    // Refine with the window-specialized kernels of RefineCornersSubPix instead of
+    // cv::cornerSubPix; off by default.
+    bool GetUseSubPixKernels() const;
+    // Loosen the accuracy criteria on boards with a wide corner spacing (see
+    // GetRefinementCriteria); off by default, which keeps the criteria as configured.
+    bool GetScaleSubPixCriteria() const;
+    PerformanceProfile GetPerformanceProfile() const;
+    DistortionModel GetDistortionModel() const;
+    // Termination of the solver. The epsilon bounds the parameter change for the OPENCV
+    // solver and the relative error decrease for the SPARSE one (see sparse_calibration.h).
+    cv::TermCriteria GetSolverCriteria() const;
 
     void SetCalibrationGridPattern(const std::string&);
     void SetCalibrationBoardSize(const cv::Size&);
@@ -83,6 +219,31 @@ public:
     void SetImageSourceType(const std::string&);
     void SetImageSourcePath(const std::string&);
     void SetCameraParametersFilePath(const std::string&);
+    void SetCameraParametersFileFormat(const CameraParametersFileFormat&);
+    void SetThreadCount(const int&);
+    void SetDecodeScale(const int&);
+    void SetUseDetectionCache(const bool&);
+    void SetUseCornerTracking(const bool&);
+    void SetExpectedSquareSize(const int&);
+    void SetDetectionCascade(const std::vector<DetectionStage>&);
+    void SetUseQualityFilter(const bool&);
+    void SetMinSharpness(const double&);
+    void SetMaxClippedFraction(const double&);
+    void SetDuplicateHashDistance(const int&);
+    void SetCalibrationSolver(const CalibrationSolver&);
+    void SetAccuracyCriteria(const cv::TermCriteria&);
+    void SetSearchWindowSize(const cv::Size&);
+    void SetMaxSearchWindowSize(const int&);
+    void SetZeroZoneSize(const cv::Size&);
+    void SetUseSubPixKernels(const bool&);
+    void SetScaleSubPixCriteria(const bool&);
+    // Overwrites the detection cascade, the maximum sub-pixel window size, the accuracy
+    // criteria, the distortion model and the solver criteria with the preset values.
+    // Settings applied afterwards override the preset; the settings JSON applies
+    // "profile" before any of those keys.
+    void SetPerformanceProfile(const PerformanceProfile&);
+    void SetDistortionModel(const DistortionModel&);
+    void SetSolverCriteria(const cv::TermCriteria&);
     
     friend class CameraCalibrationSettingsHandler;
     friend class CameraCalibration;
@@ -95,10 +256,29 @@ private:
     std::string image_source_type_;
     std::string image_source_path_;
     std::string camera_parameters_file_path_;
+    CameraParametersFileFormat camera_parameters_file_format_;
+    int thread_count_;
+    int decode_scale_;
+    bool use_detection_cache_;
+    bool use_corner_tracking_;
+    int expected_square_size_;
+    std::vector<DetectionStage> detection_cascade_;
+    bool use_quality_filter_;
+    double min_sharpness_;
+    double max_clipped_fraction_;
+    int duplicate_hash_distance_;
+    CalibrationSolver calibration_solver_;
 
     cv::TermCriteria accuracy_criteria_;
     cv::Size search_windows_size_;
+    int max_search_window_size_;
     cv::Size zero_zone_size_;
+    bool use_subpix_kernels_;
+    bool scale_subpix_criteria_;
+
+    PerformanceProfile performance_profile_;
+    DistortionModel distortion_model_;
+    cv::TermCriteria solver_criteria_;
 };
 
 
@@ -106,31 +286,66 @@ class CameraCalibration final
 {
 public:
     
+    explicit CameraCalibration(const CameraCalibrationSettings& camera_calibration_settings);
+
     CameraCalibration(
         const CameraCalibrationSettings& camera_calibration_settings,
         const std::vector<cv::Mat>& calibration_images_bgr);
+
+    CameraCalibration(
+        const CameraCalibrationSettings& camera_calibration_settings,
+        const std::vector<std::vector<cv::Point2f>>& image_points,
+        const cv::Size& image_size);
         
     CameraCalibration() = delete;
     CameraCalibration(const CameraCalibration&) = delete;
-    CameraCalibration(CameraCalibration&&) = delete;
+    CameraCalibration(CameraCalibration&&) = default;
     CameraCalibration& operator=(const CameraCalibration&) = delete;
-    CameraCalibration& operator=(CameraCalibration&&) = delete;
+    CameraCalibration& operator=(CameraCalibration&&) = default;
     
     ~CameraCalibration() {};
 
+    // Detects the pattern on a BGR or grayscale image and adds it as a view if found.
+    bool AddView(const cv::Mat& image);
+    // Detects the pattern on all images in parallel; returns the number of views added.
+    size_t AddViews(const std::vector<cv::Mat>& images);
+    // Adds already detected and refined corners of one view.
+    void AddDetections(const std::vector<cv::Point2f>& corners, const cv::Size& image_size);
+    // Adds every view of a corner dataset (board indices, weights and flags are kept).
+    void AddDetections(const CornerDataset& detections, const cv::Size& image_size);
+
+    size_t GetViewCount() const { return observations_.GetViewCount(); }
+    cv::Size GetImageSize() const { return image_size_; }
+    const CalibrationObservations& GetObservations() const { return observations_; }
+    // Fraction of the image area (on a coarse grid) that contains at least one detected corner.
+    double GetCoverage() const;
+
+    // Calibrates on the views added so far. SolveAsync works on a snapshot of the
+    // current views, so more views may be added while it runs.
+    CameraParameters Solve();
+    std::future<CameraParameters> SolveAsync() const;
+
     CameraParameters ExtractCameraParameters() const { return camera_parameters_; }
 
 private:
 
+    static const int kCoverageGridSize { 16 };
+
     CameraCalibrationSettings calibration_settings_;
-    std::vector<cv::Mat> calibration_images_;
     CameraParameters camera_parameters_;
+    cv::Size image_size_;
 
-    std::vector<std::vector<cv::Point3f>> reference_points_ { 1 };
-    std::vector<std::vector<cv::Point2f>> real_points_;
+    CalibrationObservations observations_;
+    std::vector<char> coverage_grid_;
 
     void CalculateReferenceGridPoints();
-    void CalculateRealChessboardPoints();
+    void SetImageSize(const cv::Size& image_size);
+    void UpdateCoverage(size_t view);
+
+    static CameraParameters Calibrate(
+        const CameraCalibrationSettings& calibration_settings,
+        const CalibrationObservations& observations,
+        const cv::Size& image_size);
 
     friend bool cv::findChessboardCorners(
         cv::InputArray image, 
@@ -151,8 +366,35 @@ private:
 };
 
 
+bool FindChessboardCorners(const cv::Mat& image_gray, const CameraCalibrationSettings&, std::vector<cv::Point2f>& corners);
+bool FindChessboardCorners(
+    const cv::Mat& image_gray, 
+    const CameraCalibrationSettings&, 
+    std::vector<cv::Point2f>& corners, 
+    DetectionStage& found_stage);
+// Sub-pixel refinement with cv::cornerSubPix, or with RefineCornersSubPix when the
+// settings enable the sub-pixel kernels; thread_count > 1 then splits the corners of
+// this one view across workers.
+void RefineChessboardCorners(
+    const cv::Mat& image_gray, 
+    const CameraCalibrationSettings&, 
+    std::vector<cv::Point2f>& corners, 
+    int thread_count = 1);
+bool DetectChessboardCorners(const cv::Mat& image_gray, const CameraCalibrationSettings&, std::vector<cv::Point2f>& corners);
+
 void UndistortPoint(const cv::Point2f&, cv::Point2f&, const CameraParameters&, const cv::Size&);
 
+// Batch version of UndistortPoint over contiguous buffers of point_count points.
+// src and dst may be the same buffer. Without an image size the points are
+// undistorted with the camera matrix, otherwise with the cached optimal new camera
+// matrix for that size.
+void UndistortPoints(
+    const cv::Point2f* src, 
+    cv::Point2f* dst, 
+    size_t point_count, 
+    const CameraParameters&, 
+    const cv::Size& image_size = cv::Size(-1, -1));
+
 
 } // namespace camera_calibration
 
@@ -0,0 +1,70 @@
+#ifndef CAMERA_CALIBRATION_CAMERA_PARAMETERS_BINARY_H_
+#define CAMERA_CALIBRATION_CAMERA_PARAMETERS_BINARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "camera_calibration/camera_calibration.h"
+
+namespace camera_calibration {
+
+
+class MappedFile;
+
+const char kCameraParametersBinaryMagic[8] { 'C', 'A', 'M', 'P', 'A', 'R', 'A', 'M' };
+const uint32_t kCameraParametersBinaryVersion { 2 };
+// Header size of version 1 files, which have no inverse distortion model.
+const uint32_t kCameraParametersBinaryHeaderSizeV1 { 96 };
+
+// Binary camera parameter file layout (native little-endian). The header is
+// followed by sections of doubles at the given byte offsets, each 8-byte
+// aligned, so a mapped file can be used in place:
+//   camera matrix              camera_matrix_rows x camera_matrix_cols, row-major
+//   distortion coefficients    distortion_coefficients_rows x distortion_coefficients_cols
+//   rotation vectors           view_count x 3
+//   translation vectors        view_count x 3
+//   inverse distortion model   inverse_distortion_coefficient_count (version 2)
+// Readers must use header_size and the offsets rather than assume the layout,
+// newer versions may append fields and sections.
+struct CameraParametersBinaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+
+    int32_t image_width;
+    int32_t image_height;
+    double reprojection_error;
+
+    uint32_t camera_matrix_rows;
+    uint32_t camera_matrix_cols;
+    uint32_t distortion_coefficients_rows;
+    uint32_t distortion_coefficients_cols;
+    uint32_t view_count;
+    uint32_t reserved;
+
+    uint64_t camera_matrix_offset;
+    uint64_t distortion_coefficients_offset;
+    uint64_t rotation_vectors_offset;
+    uint64_t translation_vectors_offset;
+
+    uint32_t inverse_distortion_coefficient_count;
+    uint32_t reserved_v2;
+    uint64_t inverse_distortion_coefficients_offset;
+    double inverse_distortion_max_error;
+    double inverse_distortion_rms_error;
+};
+
+static_assert(sizeof(CameraParametersBinaryHeader) == 128, "unexpected camera parameters header layout");
+
+
+bool IsCameraParametersBinary(const unsigned char* data, size_t size);
+bool ReadCameraParametersBinary(const MappedFile& file, CameraParameters& camera_parameters);
+bool WriteCameraParametersBinary(const std::string& filename, const CameraParameters& camera_parameters);
+
+
+} // namespace camera_calibration
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CAMERA_CALIBRATION_CHESSBOARD_DETECTION_H_
+#define CAMERA_CALIBRATION_CHESSBOARD_DETECTION_H_
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+
+namespace camera_calibration {
+
+
+// Number of times an image may be halved before chessboard detection so that a
+// board square still spans enough pixels to be found. expected_square_size is the
+// square size in pixels at full resolution; 0 estimates it from the image size,
+// assuming the board covers at least a third of the shorter image side.
+int GetDetectionPyramidLevelCount(const cv::Size& image_size, const cv::Size& board_size, int expected_square_size);
+
+// Coarse-to-fine chessboard detection: the detection cascade runs on the image halved
+// level_count times, and the corners found there are carried back up the pyramid
+// and re-centred with cornerSubPix on every finer level, so the result lands on the
+// same saddle points as a full-resolution search at a fraction of its cost. If the
+// coarse level finds nothing (the board may be too small to resolve there, whether the
+// pyramid depth was estimated or derived from the expected square size), the
+// full-resolution image is searched once more with the fast check, if configured, and
+// a single detection stage: ADAPTIVE when configured, else the first one. found_stage is the cascade stage
+// that found the board.
+bool FindChessboardCornersCoarseToFine(
+    const cv::Mat& image_gray,
+    const cv::Size& board_size,
+    const std::vector<DetectionStage>& detection_cascade,
+    int level_count,
+    std::vector<cv::Point2f>& corners,
+    DetectionStage& found_stage);
+
+// Smallest distance between neighbouring corners of a board_size grid in board order.
+float GetMinimumCornerSpacing(const std::vector<cv::Point2f>& corners, const cv::Size& board_size);
+
+// cornerSubPix half window for the corners of one view: the configured search window,
+// or with a 0 x 0 window 0.3 of the corner spacing, enough to cover the saddle while
+// staying clear of the neighbouring corners, capped by the maximum search window and
+// rounded; with the sub-pixel kernels enabled, rounded to the nearest size
+// RefineCornersSubPix has a specialized kernel for.
+cv::Size GetRefinementWindowSize(
+    const std::vector<cv::Point2f>& corners, 
+    const CameraCalibrationSettings& calibration_settings);
+
+// cornerSubPix criteria for the corners of one view: the accuracy criteria. With
+// criteria scaling enabled and an adaptive window, boards with a corner spacing above
+// 36 px get the epsilon scaled up and the iteration cap scaled down by spacing / 36
+// (at least 5 iterations), so large boards in high-resolution frames converge in
+// fewer iterations.
+cv::TermCriteria GetRefinementCriteria(
+    const std::vector<cv::Point2f>& corners, 
+    const CameraCalibrationSettings& calibration_settings);
+
+// Settings file names of detection stages: "fast_check", "plain", "adaptive",
+// "filter_quads" and "equalized".
+std::string GetDetectionStageName(DetectionStage stage);
+bool ParseDetectionStageName(const std::string& name, DetectionStage& stage);
+
+} // namespace camera_calibration
+
+#endif
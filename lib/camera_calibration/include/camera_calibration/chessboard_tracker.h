@@ -0,0 +1,73 @@
+#ifndef CAMERA_CALIBRATION_CHESSBOARD_TRACKER_H_
+#define CAMERA_CALIBRATION_CHESSBOARD_TRACKER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+
+namespace camera_calibration {
+
+
+// Follows a chessboard through consecutive stream frames. Once the board has been
+// found, its corners are tracked into the next frame with pyramidal Lucas-Kanade
+// optical flow and snapped back onto the saddle points with cornerSubPix, which costs
+// a few milliseconds instead of a full findChessboardCorners. Tracked corners must
+// still form a consistent grid. When tracking fails, the board is first searched in a
+// crop around its last position, padded by the board motion measured between the last
+// two detections, and only then on the whole frame.
+class ChessboardTracker final
+{
+public:
+
+    explicit ChessboardTracker(const CameraCalibrationSettings& calibration_settings);
+
+    // Finds the board on a grayscale frame; corners are in board order, not refined
+    // with the calibration sub-pixel settings.
+    bool Process(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners);
+    // Forgets the previous frame and board position, so the next frame is fully detected.
+    void Reset();
+
+    bool WasLastFrameTracked() const { return last_frame_tracked_; }
+    bool WasLastFrameFoundInRegion() const { return last_frame_found_in_region_; }
+    size_t GetTrackedFrameCount() const { return tracked_frame_count_; }
+    size_t GetRegionDetectedFrameCount() const { return region_detected_frame_count_; }
+    size_t GetDetectedFrameCount() const { return detected_frame_count_; }
+
+private:
+
+    CameraCalibrationSettings calibration_settings_;
+
+    cv::Mat previous_image_gray_;
+    std::vector<cv::Point2f> previous_corners_;
+    // Bounding box of the board on the last frame it was found on.
+    cv::Point2f board_minimum_;
+    cv::Point2f board_maximum_;
+    // Displacement of the board center per frame between the last two detections.
+    float board_motion_ { 0.0f };
+    bool has_board_region_ { false };
+    int missed_frame_count_ { 0 };
+
+    bool last_frame_tracked_ { false };
+    bool last_frame_found_in_region_ { false };
+    size_t tracked_frame_count_ { 0 };
+    size_t region_detected_frame_count_ { 0 };
+    size_t detected_frame_count_ { 0 };
+
+    bool Track(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners) const;
+    bool DetectInRegion(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners) const;
+    bool GetSearchRegion(const cv::Size& image_size, cv::Rect& region) const;
+    void UpdateBoardRegion(const std::vector<cv::Point2f>& corners);
+};
+
+// Cheap plausibility test for corners of a board_size grid in board order: every cell
+// keeps the orientation of the first one and neighbouring spacings along rows and
+// columns stay close to each other.
+bool IsChessboardGridConsistent(const std::vector<cv::Point2f>& corners, const cv::Size& board_size);
+
+
+} // namespace camera_calibration
+
+#endif
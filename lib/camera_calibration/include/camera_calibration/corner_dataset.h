@@ -0,0 +1,80 @@
+#ifndef CAMERA_CALIBRATION_CORNER_DATASET_H_
+#define CAMERA_CALIBRATION_CORNER_DATASET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace camera_calibration {
+
+
+// Detected corners of many views stored as structure of arrays: x, y, weight, board
+// point index and validity flag of every corner in separate contiguous arrays, views
+// one after another. View v owns corners [GetViewBegin(v), GetViewEnd(v)).
+// Invalid corners stay in place (indices do not shift) and are skipped by the
+// calibration; weights scale a corner's residual in the sparse solver.
+class CornerDataset final
+{
+public:
+
+    size_t GetViewCount() const { return view_offsets_.size() - 1; }
+    size_t GetCornerCount() const { return x_.size(); }
+    size_t GetViewBegin(size_t view) const { return static_cast<size_t>(view_offsets_[view]); }
+    size_t GetViewEnd(size_t view) const { return static_cast<size_t>(view_offsets_[view + 1]); }
+    size_t GetViewCornerCount(size_t view) const { return GetViewEnd(view) - GetViewBegin(view); }
+
+    const float* GetX() const { return x_.data(); }
+    const float* GetY() const { return y_.data(); }
+    const float* GetWeights() const { return weights_.data(); }
+    const int32_t* GetBoardIndices() const { return board_indices_.data(); }
+    const uint8_t* GetValidFlags() const { return valid_.data(); }
+
+    cv::Point2f GetCorner(size_t index) const { return cv::Point2f(x_[index], y_[index]); }
+    float GetWeight(size_t index) const { return weights_[index]; }
+    int GetBoardIndex(size_t index) const { return board_indices_[index]; }
+    bool IsValid(size_t index) const { return valid_[index] != 0; }
+
+    void SetCorner(size_t index, const cv::Point2f& corner);
+    void SetWeight(size_t index, float weight);
+    void SetValid(size_t index, bool valid);
+
+    // Valid corners of a view in storage order.
+    std::vector<cv::Point2f> GetViewCorners(size_t view) const;
+
+    // Appends a view and returns its index. Without board indices corner i is the image
+    // of board point i, without weights every weight is 1. All corners start valid.
+    size_t AddView(
+        const cv::Point2f* corners,
+        size_t corner_count,
+        const int32_t* board_indices = nullptr,
+        const float* weights = nullptr);
+    size_t AddView(const std::vector<cv::Point2f>& corners);
+    // Appends view `view` of another dataset with its weights and flags.
+    size_t AddView(const CornerDataset& dataset, size_t view);
+
+    void Reserve(size_t view_count, size_t corner_count);
+    void Clear();
+
+    // Binary form: view and corner counts followed by each array written as one
+    // block, so writing and reading cost one copy per array.
+    bool WriteTo(std::ostream& out) const;
+    bool ReadFrom(std::istream& in);
+
+private:
+
+    std::vector<uint64_t> view_offsets_ { 0 };
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> weights_;
+    std::vector<int32_t> board_indices_;
+    std::vector<uint8_t> valid_;
+};
+
+
+} // namespace camera_calibration
+
+#endif
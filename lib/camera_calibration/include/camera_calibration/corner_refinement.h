@@ -0,0 +1,42 @@
+#ifndef CAMERA_CALIBRATION_CORNER_REFINEMENT_H_
+#define CAMERA_CALIBRATION_CORNER_REFINEMENT_H_
+
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+namespace camera_calibration {
+
+
+// cv::cornerSubPix for all corners of a view in one call. For 8-bit grayscale images
+// and square half windows of 5, 7, 11 or 15 it runs a kernel compiled for that window
+// size: the window weights, patch buffers and loop bounds are fixed at compile time
+// and the gradient sums are accumulated in SIMD registers (AVX2+FMA or SSE2, picked at
+// run time). Gradient products are summed in single precision per window row and in
+// double precision across rows; patch sampling, iteration and rejection rules are the
+// same. test/corner_refinement_test.cpp compares the results with cv::cornerSubPix at
+// a 1e-3 px tolerance, and RefineChessboardCorners only calls this function when the
+// settings enable the sub-pixel kernels. Other windows and image types go to
+// cv::cornerSubPix. Corners are refined on thread_count workers
+// (0 = all hardware threads), which only pays off for views with many corners.
+void RefineCornersSubPix(
+    const cv::Mat& image_gray,
+    cv::Point2f* corners,
+    size_t corner_count,
+    const cv::Size& window_size,
+    const cv::Size& zero_zone_size,
+    const cv::TermCriteria& criteria,
+    int thread_count = 1);
+
+// Half window the kernel is specialized for that is nearest to half_window without
+// exceeding max_half_window (ties go to the smaller one); half_window rounded, capped
+// at max_half_window, if it is below all of them.
+int GetSpecializedRefinementWindow(float half_window, int max_half_window);
+
+// Name of the SIMD implementation RefineCornersSubPix dispatches to.
+const char* GetCornerRefinementKernelName();
+
+
+} // namespace camera_calibration
+
+#endif
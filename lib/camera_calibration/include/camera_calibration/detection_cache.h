@@ -0,0 +1,85 @@
+#ifndef CAMERA_CALIBRATION_DETECTION_CACHE_H_
+#define CAMERA_CALIBRATION_DETECTION_CACHE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/corner_dataset.h"
+
+namespace camera_calibration {
+
+
+// Persistent store of detection results keyed by image file content and by the
+// settings that affect detection (pattern, board size, decode scale and sub-pixel
+// refinement parameters). Only entries found or inserted since loading are saved, so
+// results for deleted images and for earlier settings are pruned from the file.
+// Corners of all entries are kept in one corner dataset, which the binary cache file
+// stores as is. Find and Insert may be called concurrently.
+class DetectionCache final
+{
+public:
+
+    struct Entry
+    {
+        bool pattern_found;
+        cv::Size image_size;
+        std::vector<cv::Point2f> corners;
+        // Detection cascade stage that found the board.
+        DetectionStage detection_stage;
+        // Difference hash of the image (see ImageQuality), 0 without the quality filter.
+        uint64_t image_hash;
+    };
+
+    DetectionCache(const std::string& cache_file_path, const CameraCalibrationSettings& calibration_settings);
+
+    DetectionCache(const DetectionCache&) = delete;
+    DetectionCache& operator=(const DetectionCache&) = delete;
+
+    bool LoadFromFile();
+    bool SaveToFile() const;
+
+    uint64_t GetKey(const std::vector<uchar>& image_file_content) const;
+    bool Find(uint64_t key, Entry& entry) const;
+    void Insert(uint64_t key, const Entry& entry);
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+
+    // Cache file location for an image source path: one file per directory, and one
+    // per glob pattern within a directory, so runs over different patterns do not prune
+    // each other's entries.
+    static std::string GetDefaultFilePath(const std::string& image_source_path);
+
+private:
+
+    std::string cache_file_path_;
+    uint64_t settings_hash_;
+
+    struct StoredEntry
+    {
+        bool pattern_found;
+        cv::Size image_size;
+        size_t view;
+        DetectionStage detection_stage;
+        uint64_t image_hash;
+        // Found or inserted since loading; the only entries SaveToFile keeps.
+        mutable bool used;
+    };
+
+    std::unordered_map<uint64_t, StoredEntry> entries_;
+    CornerDataset corners_;
+    mutable size_t hit_count_ { 0 };
+    mutable size_t miss_count_ { 0 };
+    mutable std::mutex mutex_;
+};
+
+
+} // namespace camera_calibration
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CAMERA_CALIBRATION_HASH_H_
+#define CAMERA_CALIBRATION_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace camera_calibration {
+
+
+const uint64_t kFnvOffsetBasis { 14695981039346656037ULL };
+const uint64_t kFnvPrime { 1099511628211ULL };
+
+// 64-bit FNV-1a; pass a previous result as hash to continue hashing.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = kFnvOffsetBasis)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i { 0 }; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+
+} // namespace camera_calibration
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef CAMERA_CALIBRATION_IMAGE_INGEST_H_
+#define CAMERA_CALIBRATION_IMAGE_INGEST_H_
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/corner_dataset.h"
+#include "camera_calibration/image_quality.h"
+
+namespace camera_calibration {
+
+
+class DetectionCache;
+
+// View v of corners was detected on image_names[v] by detection cascade stage
+// detection_stages[v]. Images dropped by the quality filter are listed with the
+// reason in rejected_image_names and rejection_reasons.
+struct ChessboardDetections
+{
+    cv::Size image_size;
+    CornerDataset corners;
+    std::vector<std::string> image_names;
+    std::vector<DetectionStage> detection_stages;
+    std::vector<std::string> rejected_image_names;
+    std::vector<ImageQualityIssue> rejection_reasons;
+};
+
+
+// Pipelined directory ingest: file reading, decoding to grayscale and corner
+// detection run as separate stages connected by bounded queues, so at most
+// queue_depth images per stage are held in memory at any time. Each image is
+// released as soon as its corners are extracted. Accepted views keep the order
+// of image_names.
+//
+// Images are decoded straight to grayscale. With a decode scale above 1 the
+// corners are searched on a reduced decode and refined on a full resolution
+// decode, which is only done for images where the board was found.
+//
+// With the quality filter, blurry and badly exposed images are dropped before
+// detection. Near-duplicates can only be told apart in image order, which the
+// parallel stages do not keep, so they are dropped after detection: of images with
+// nearly equal hashes the first one is kept.
+class DirectoryImageIngest final
+{
+public:
+
+    DirectoryImageIngest(const CameraCalibrationSettings& calibration_settings, size_t queue_depth = 4);
+
+    // With a detection cache, images whose content and detection settings are already
+    // in the cache skip decoding and detection; new results are added to the cache.
+    ChessboardDetections Run(
+        const std::vector<cv::String>& image_names, 
+        DetectionCache* detection_cache = nullptr) const;
+
+private:
+
+    CameraCalibrationSettings calibration_settings_;
+    size_t queue_depth_;
+};
+
+
+} // namespace camera_calibration
+
+#endif
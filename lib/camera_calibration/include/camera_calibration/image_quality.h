@@ -0,0 +1,51 @@
+#ifndef CAMERA_CALIBRATION_IMAGE_QUALITY_H_
+#define CAMERA_CALIBRATION_IMAGE_QUALITY_H_
+
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+
+namespace camera_calibration {
+
+
+enum class ImageQualityIssue
+{
+    NONE,
+    BLURRY,
+    UNDEREXPOSED,
+    OVEREXPOSED,
+    DUPLICATE
+};
+
+
+// Cheap measurements taken before chessboard detection, all on a downsample of the
+// frame so their cost does not grow with the resolution.
+struct ImageQuality
+{
+    // Variance of the Laplacian: low for blurred frames.
+    double sharpness { 0.0 };
+    // Fractions of pixels close to black and close to white.
+    double dark_fraction { 0.0 };
+    double bright_fraction { 0.0 };
+    // 64-bit difference hash (dHash); near-duplicate frames differ in few bits.
+    uint64_t hash { 0 };
+};
+
+ImageQuality MeasureImageQuality(const cv::Mat& image_gray);
+
+// Reason a frame is dropped before detection; NONE if it passes.
+ImageQualityIssue CheckImageQuality(const ImageQuality& quality, const CameraCalibrationSettings& calibration_settings);
+
+// True if the hashes differ in fewer bits than the duplicate_hash_distance setting.
+bool IsDuplicateImage(uint64_t hash, uint64_t other_hash, const CameraCalibrationSettings& calibration_settings);
+
+// Report names: "blurry", "underexposed", "overexposed", "duplicate".
+std::string GetImageQualityIssueName(ImageQualityIssue issue);
+
+
+} // namespace camera_calibration
+
+#endif
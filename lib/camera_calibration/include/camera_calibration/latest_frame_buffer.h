@@ -0,0 +1,67 @@
+#ifndef CAMERA_CALIBRATION_LATEST_FRAME_BUFFER_H_
+#define CAMERA_CALIBRATION_LATEST_FRAME_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+namespace camera_calibration {
+
+
+// Lock-free single-producer / single-consumer ring of three frame slots with a
+// "latest frame wins" policy. The producer owns one slot it writes into, the consumer
+// owns one slot it reads from and the third slot holds the last published frame.
+// Publishing and acquiring swap a slot with the published one, so no frame is ever
+// copied and the slots keep their buffers (cv::Mat reallocates only on a size or type
+// change). A published frame that is replaced before the consumer takes it is dropped.
+class LatestFrameBuffer final
+{
+public:
+
+    LatestFrameBuffer() = default;
+
+    LatestFrameBuffer(const LatestFrameBuffer&) = delete;
+    LatestFrameBuffer& operator=(const LatestFrameBuffer&) = delete;
+
+    // Producer side.
+    cv::Mat& GetWriteFrame() { return frames_[write_index_]; }
+    // Publishes the write frame; returns true if an unread frame was dropped for it.
+    bool Publish()
+    {
+        uint8_t previous = published_.exchange(static_cast<uint8_t>(write_index_ | kFreshFlag), std::memory_order_acq_rel);
+        write_index_ = previous & kIndexMask;
+        return (previous & kFreshFlag) != 0;
+    }
+
+    // Either side: true while a published frame has not been acquired.
+    bool HasNewFrame() const { return (published_.load(std::memory_order_acquire) & kFreshFlag) != 0; }
+
+    // Consumer side. Makes the newest published frame the read frame; returns false
+    // (keeping the current read frame) if nothing new was published.
+    bool Acquire()
+    {
+        if (!HasNewFrame()) {
+            return false;
+        }
+        uint8_t previous = published_.exchange(static_cast<uint8_t>(read_index_), std::memory_order_acq_rel);
+        read_index_ = previous & kIndexMask;
+        return true;
+    }
+    const cv::Mat& GetReadFrame() const { return frames_[read_index_]; }
+
+private:
+
+    static const uint8_t kIndexMask { 0x03 };
+    static const uint8_t kFreshFlag { 0x04 };
+
+    cv::Mat frames_[3];
+    int write_index_ { 0 };
+    int read_index_ { 1 };
+    std::atomic<uint8_t> published_ { 2 };
+};
+
+
+} // namespace camera_calibration
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef CAMERA_CALIBRATION_MAPPED_FILE_H_
+#define CAMERA_CALIBRATION_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace camera_calibration {
+
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to reading the file into memory elsewhere.
+class MappedFile final
+{
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    const unsigned char* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+
+private:
+
+    const unsigned char* data_ { nullptr };
+    size_t size_ { 0 };
+    bool mapped_ { false };
+    std::vector<unsigned char> buffer_;
+};
+
+
+} // namespace camera_calibration
+
+#endif
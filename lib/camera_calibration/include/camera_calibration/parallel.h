@@ -0,0 +1,207 @@
+#ifndef CAMERA_CALIBRATION_PARALLEL_H_
+#define CAMERA_CALIBRATION_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace camera_calibration {
+
+
+// Number of workers to use for a requested thread count (0 = all hardware threads).
+inline int ResolveThreadCount(int thread_count)
+{
+    if (thread_count > 0) {
+        return thread_count;
+    }
+    int hardware_threads = static_cast<int>(std::thread::hardware_concurrency());
+    return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+// Runs task(index) for every index in [0, task_count) on up to thread_count workers.
+// Tasks are handed out one at a time, so the caller decides where each result lands.
+// The first exception thrown by a task is rethrown in the calling thread.
+inline void ParallelFor(size_t task_count, int thread_count, const std::function<void(size_t)>& task)
+{
+    size_t worker_count = std::min(static_cast<size_t>(ResolveThreadCount(thread_count)), task_count);
+
+    if (worker_count <= 1) {
+        for (size_t index { 0 }; index < task_count; ++index) {
+            task(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index { 0 };
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+
+    auto worker = [&]() {
+        for (size_t index = next_index++; index < task_count; index = next_index++) {
+            try {
+                task(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!first_exception) {
+                    first_exception = std::current_exception();
+                }
+                next_index = task_count;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_count - 1);
+    for (size_t i { 1 }; i < worker_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+
+// Workers kept alive across many ParallelFor-style loops, for callers that run short
+// loops back to back (an iterative solver) and would otherwise start and join threads
+// for each one. Run has the semantics of ParallelFor; the calling thread takes part,
+// so a pool of thread_count workers starts thread_count - 1 threads. Run must not be
+// called concurrently or from inside a task.
+class ThreadPool final
+{
+public:
+
+    explicit ThreadPool(int thread_count)
+    {
+        int worker_count = ResolveThreadCount(thread_count);
+        workers_.reserve(worker_count - 1);
+        for (int i { 1 }; i < worker_count; ++i) {
+            workers_.emplace_back(&ThreadPool::Work, this);
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto& thread : workers_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int GetThreadCount() const { return static_cast<int>(workers_.size()) + 1; }
+
+    void Run(size_t task_count, const std::function<void(size_t)>& task)
+    {
+        if (workers_.empty() || task_count <= 1) {
+            for (size_t index { 0 }; index < task_count; ++index) {
+                task(index);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            task_count_ = task_count;
+            next_index_ = 0;
+            first_exception_ = nullptr;
+            active_worker_count_ = workers_.size();
+            ++generation_;
+        }
+        start_.notify_all();
+
+        RunTasks(task, task_count);
+
+        std::exception_ptr first_exception;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            finished_.wait(lock, [this]() { return active_worker_count_ == 0; });
+            task_ = nullptr;
+            std::swap(first_exception, first_exception_);
+        }
+        if (first_exception) {
+            std::rethrow_exception(first_exception);
+        }
+    }
+
+private:
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable finished_;
+    const std::function<void(size_t)>* task_ { nullptr };
+    size_t task_count_ { 0 };
+    std::atomic<size_t> next_index_ { 0 };
+    std::exception_ptr first_exception_;
+    size_t active_worker_count_ { 0 };
+    uint64_t generation_ { 0 };
+    bool stop_ { false };
+
+    void RunTasks(const std::function<void(size_t)>& task, size_t task_count)
+    {
+        for (size_t index = next_index_++; index < task_count; index = next_index_++) {
+            try {
+                task(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!first_exception_) {
+                    first_exception_ = std::current_exception();
+                }
+                next_index_ = task_count;
+            }
+        }
+    }
+
+    // Every worker takes part in every Run (Run waits for all of them), so none can
+    // miss a generation.
+    void Work()
+    {
+        uint64_t generation { 0 };
+        for (;;) {
+            const std::function<void(size_t)>* task;
+            size_t task_count;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_.wait(lock, [this, generation]() { return stop_ || generation_ != generation; });
+                if (stop_) {
+                    return;
+                }
+                generation = generation_;
+                task = task_;
+                task_count = task_count_;
+            }
+
+            RunTasks(*task, task_count);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_worker_count_ == 0) {
+                finished_.notify_one();
+            }
+        }
+    }
+};
+
+
+} // namespace camera_calibration
+
+#endif
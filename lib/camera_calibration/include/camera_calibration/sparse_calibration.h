@@ -0,0 +1,43 @@
+#ifndef CAMERA_CALIBRATION_SPARSE_CALIBRATION_H_
+#define CAMERA_CALIBRATION_SPARSE_CALIBRATION_H_
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/calibration_observations.h"
+
+namespace camera_calibration {
+
+
+// Calibrates the same model as cv::calibrateCamera with flags = 0 (fx, fy, cx, cy and
+// k1, k2, p1, p2, k3) with a Levenberg-Marquardt solver that uses the block structure of
+// the problem: the intrinsics are shared by all views, the 6-DOF pose of a view only
+// affects that view's corners. Per-view pose blocks are eliminated with the Schur
+// complement, so every iteration solves a 9x9 system and costs time linear in the
+// number of views. Per-view Jacobians are evaluated on thread_count workers
+// (0 = all hardware threads), started once per solve. Every view is projected through the shared board model,
+// so no per-view copy of the object points is made. Invalid corners are skipped and
+// each residual is scaled by its corner weight.
+// distortion_coefficients is returned as 8x1 (k4..k6 are zero), rotation and
+// translation vectors as 3x1, all CV_64F. Returns the (weighted) RMS reprojection
+// error in pixels. The only supported flag is cv::CALIB_FIX_K3, which keeps k3 at zero.
+// criteria.maxCount bounds the number of accepted steps. criteria.epsilon is a bound
+// on the relative decrease of the weighted squared error per step, not the bound on
+// the parameter change cv::calibrateCamera applies to the same TermCriteria, so equal
+// criteria do not stop both solvers at the same point.
+double CalibrateCameraSparse(
+    const CalibrationObservations& observations,
+    const cv::Size& image_size,
+    cv::Mat& camera_matrix,
+    cv::Mat& distortion_coefficients,
+    std::vector<cv::Mat>& rotation_vectors,
+    std::vector<cv::Mat>& translation_vectors,
+    int thread_count = 0,
+    const cv::TermCriteria& criteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, 1e-12),
+    int flags = 0);
+
+
+} // namespace camera_calibration
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CAMERA_CALIBRATION_STREAM_CAPTURE_H_
+#define CAMERA_CALIBRATION_STREAM_CAPTURE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "camera_calibration/latest_frame_buffer.h"
+
+namespace camera_calibration {
+
+
+// Reads a video stream on its own thread so the source never backs up while the
+// consumer is busy. The thread calls grab() continuously, which keeps network streams
+// at real time, and decodes (retrieve()) a grabbed frame only when the consumer has
+// taken the previous one; the other grabbed frames are dropped undecoded. Decoded
+// frames reach the consumer through a LatestFrameBuffer, and a consumer waiting in
+// Read is woken when one is published.
+class StreamCapture final
+{
+public:
+
+    StreamCapture() = default;
+    ~StreamCapture();
+
+    StreamCapture(const StreamCapture&) = delete;
+    StreamCapture& operator=(const StreamCapture&) = delete;
+
+    bool Open(const std::string& source);
+    void Close();
+
+    // Waits up to timeout_ms for a frame newer than the previous Read. The frame
+    // stays valid until the next Read. Returns false on timeout or when the stream
+    // has ended.
+    bool Read(cv::Mat& frame, int timeout_ms = 1000);
+    bool IsRunning() const { return running_; }
+
+    size_t GetGrabbedFrameCount() const { return grabbed_frame_count_; }
+    size_t GetRetrievedFrameCount() const { return retrieved_frame_count_; }
+    // Grabbed frames that never reached the consumer: skipped before decoding or
+    // failed to decode.
+    size_t GetDroppedFrameCount() const { return dropped_frame_count_; }
+
+private:
+
+    cv::VideoCapture capture_;
+    LatestFrameBuffer frames_;
+    std::thread capture_thread_;
+    // Only wakes Read; the frames themselves are handed over lock-free.
+    std::mutex frame_mutex_;
+    std::condition_variable frame_published_;
+
+    std::atomic<bool> running_ { false };
+    std::atomic<bool> stop_ { false };
+    std::atomic<size_t> grabbed_frame_count_ { 0 };
+    std::atomic<size_t> retrieved_frame_count_ { 0 };
+    std::atomic<size_t> dropped_frame_count_ { 0 };
+
+    void Run();
+    void NotifyReader();
+};
+
+
+} // namespace camera_calibration
+
+#endif
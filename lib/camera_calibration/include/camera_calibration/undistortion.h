@@ -0,0 +1,160 @@
+#ifndef CAMERA_CALIBRATION_UNDISTORTION_H_
+#define CAMERA_CALIBRATION_UNDISTORTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/undistortion_kernel.h"
+
+namespace camera_calibration {
+
+
+struct UndistortionMaps
+{
+    cv::Size image_size;
+    double alpha;
+    int map_type;
+    cv::Mat new_camera_matrix;
+    cv::Mat map1;
+    cv::Mat map2;
+};
+
+
+// Full-frame undistortion with rectify maps built once per (image size, alpha, map type).
+// alpha has the meaning of cv::getOptimalNewCameraMatrix (0 - only valid pixels,
+// 1 - all source pixels). Supported map types are CV_16SC2 (compact fixed-point maps),
+// CV_32FC1 and CV_32FC2. Maps can be saved to and loaded from disk; loaded maps are
+// rejected if they were built for different camera parameters.
+class Undistorter final
+{
+public:
+
+    explicit Undistorter(const CameraParameters& camera_parameters, int thread_count = 0);
+
+    Undistorter(const Undistorter&) = delete;
+    Undistorter& operator=(const Undistorter&) = delete;
+
+    void Undistort(const cv::Mat& frame, cv::Mat& undistorted_frame, double alpha = 0.0, int map_type = CV_16SC2);
+
+    std::shared_ptr<const UndistortionMaps> GetMaps(const cv::Size& image_size, double alpha = 0.0, int map_type = CV_16SC2);
+
+    bool SaveMapsToFile(const std::string& filename, const cv::Size& image_size, double alpha = 0.0, int map_type = CV_16SC2);
+    bool LoadMapsFromFile(const std::string& filename);
+
+private:
+
+    typedef std::tuple<int, int, double, int> MapsKey;
+
+    CameraParameters camera_parameters_;
+    uint64_t camera_parameters_hash_;
+    int thread_count_;
+
+    std::map<MapsKey, std::shared_ptr<const UndistortionMaps>> maps_;
+    std::mutex maps_mutex_;
+};
+
+
+// Intrinsics and distortion of camera_parameters in the layout of the vectorized kernel.
+// Models with 4 or 5 coefficients are padded with zeros; longer models are rejected.
+RationalDistortionModel GetRationalDistortionModel(const CameraParameters& camera_parameters);
+
+// UndistortPoints without an image size, computed by the vectorized kernel.
+void UndistortPointsVectorized(
+    const cv::Point2f* src,
+    cv::Point2f* dst,
+    size_t point_count,
+    const CameraParameters& camera_parameters,
+    int iteration_count = 5,
+    float epsilon = 0.0f);
+
+
+// Closed-form inverse distortion model: maps distorted normalized coordinates (xd, yd),
+// r2 = xd^2 + yd^2, to undistorted normalized coordinates with one evaluation
+//   xu = xd * (1 + a1 r2 + a2 r2^2 + a3 r2^3 + a4 r2^4 + a5 r2^5) + 2 b1 xd yd + b2 (r2 + 2 xd^2)
+//   yu = yd * (1 + a1 r2 + a2 r2^2 + a3 r2^3 + a4 r2^4 + a5 r2^5) + b1 (r2 + 2 yd^2) + 2 b2 xd yd
+// Coefficients are stored as (a1, a2, a3, a4, a5, b1, b2).
+const int kInverseDistortionCoefficientCount { 7 };
+
+// Fits the inverse model by linear least squares on samples that cover the image area
+// and stores the coefficients with the max and RMS fit residual in pixels in
+// camera_parameters. Throws if the image is too small or the distortion too strong to
+// sample enough points inside the image.
+void FitInverseDistortionModel(CameraParameters& camera_parameters, const cv::Size& image_size);
+
+// FitInverseDistortionModel that leaves camera_parameters without an inverse model
+// instead of throwing. Returns whether the model was fitted.
+bool TryFitInverseDistortionModel(CameraParameters& camera_parameters, const cv::Size& image_size);
+
+// Same output as UndistortPoints without an image size, computed with the inverse model.
+// Parameters without an inverse model are undistorted with the iterative UndistortPoints.
+void UndistortPointsClosedForm(
+    const cv::Point2f* src,
+    cv::Point2f* dst,
+    size_t point_count,
+    const CameraParameters& camera_parameters);
+
+
+// Point undistortion through a precomputed grid over the image: each node holds the
+// exact undistorted (normalized) coordinates of a distorted pixel position, values in
+// between are bilinearly interpolated, so every point costs the same few operations.
+// Results match UndistortPoints without an image size. A grid pitch of 1 gives a dense
+// table. The maximum interpolation error is measured at build time at the cell centers
+// and edge midpoints and reported in pixels of the camera matrix.
+class UndistortionLut final
+{
+public:
+
+    UndistortionLut(const CameraParameters& camera_parameters, const cv::Size& image_size, float grid_pitch = 8.0f);
+
+    inline cv::Point2f Undistort(const cv::Point2f& point) const;
+    void Undistort(const cv::Point2f* src, cv::Point2f* dst, size_t point_count) const;
+
+    cv::Size GetImageSize() const { return image_size_; }
+    float GetGridPitch() const { return grid_pitch_; }
+    double GetMaxInterpolationError() const { return max_interpolation_error_; }
+
+private:
+
+    cv::Size image_size_;
+    float grid_pitch_;
+    float inverse_grid_pitch_;
+    int grid_columns_;
+    int grid_rows_;
+    std::vector<cv::Point2f> grid_;
+    double max_interpolation_error_ { 0.0 };
+};
+
+
+inline cv::Point2f UndistortionLut::Undistort(const cv::Point2f& point) const
+{
+    float grid_x = point.x * inverse_grid_pitch_;
+    float grid_y = point.y * inverse_grid_pitch_;
+    int column = std::min(std::max(static_cast<int>(std::floor(grid_x)), 0), grid_columns_ - 2);
+    int row = std::min(std::max(static_cast<int>(std::floor(grid_y)), 0), grid_rows_ - 2);
+    float tx = grid_x - column;
+    float ty = grid_y - row;
+
+    const cv::Point2f* top = &grid_[row * grid_columns_ + column];
+    const cv::Point2f* bottom = top + grid_columns_;
+    float top_x = top[0].x + tx * (top[1].x - top[0].x);
+    float top_y = top[0].y + tx * (top[1].y - top[0].y);
+    float bottom_x = bottom[0].x + tx * (bottom[1].x - bottom[0].x);
+    float bottom_y = bottom[0].y + tx * (bottom[1].y - bottom[0].y);
+
+    return cv::Point2f(top_x + ty * (bottom_x - top_x), top_y + ty * (bottom_y - top_y));
+}
+
+
+} // namespace camera_calibration
+
+#endif
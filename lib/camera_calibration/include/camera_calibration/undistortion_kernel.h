@@ -0,0 +1,36 @@
+#ifndef CAMERA_CALIBRATION_UNDISTORTION_KERNEL_H_
+#define CAMERA_CALIBRATION_UNDISTORTION_KERNEL_H_
+
+#include <cstddef>
+
+namespace camera_calibration {
+
+
+// Pinhole intrinsics plus the 8-coefficient rational distortion model
+// (k1, k2, p1, p2, k3, k4, k5, k6), the layout produced by CameraCalibration.
+struct RationalDistortionModel
+{
+    float fx, fy, cx, cy;
+    float k1, k2, p1, p2, k3, k4, k5, k6;
+};
+
+// Undistorts point_count interleaved (x, y) pixel coordinates into normalized
+// coordinates with the same fixed-point iteration as cv::undistortPoints. With
+// epsilon > 0 a block of points stops iterating as soon as no coordinate moved by
+// more than epsilon. src and dst may be the same buffer. The implementation is
+// picked at run time: AVX2+FMA, SSE2 or scalar.
+void UndistortPointsVectorized(
+    const RationalDistortionModel& model,
+    const float* src,
+    float* dst,
+    size_t point_count,
+    int iteration_count = 5,
+    float epsilon = 0.0f);
+
+// Name of the implementation UndistortPointsVectorized dispatches to.
+const char* GetUndistortionKernelName();
+
+
+} // namespace camera_calibration
+
+#endif
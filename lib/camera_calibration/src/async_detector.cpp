@@ -0,0 +1,178 @@
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/async_detector.h"
+
+namespace camera_calibration {
+
+
+AsyncChessboardDetector::AsyncChessboardDetector(const CameraCalibrationSettings& calibration_settings)
+	: tracker_(calibration_settings)
+{
+	calibration_settings_ = calibration_settings;
+	worker_ = std::thread(&AsyncChessboardDetector::Run, this);
+}
+
+AsyncChessboardDetector::~AsyncChessboardDetector()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	frame_available_.notify_one();
+	worker_.join();
+}
+
+void AsyncChessboardDetector::Submit(const cv::Mat& image, uint64_t frame_id)
+{
+	cv::Mat image_gray;
+	if (image.channels() == 1) {
+		image.copyTo(image_gray);
+	}
+	else {
+		cv::cvtColor(image, image_gray, cv::COLOR_BGR2GRAY);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (has_pending_frame_) {
+			++skipped_frame_count_;
+		}
+		pending_image_ = image_gray;
+		pending_frame_id_ = frame_id;
+		has_pending_frame_ = true;
+	}
+	frame_available_.notify_one();
+}
+
+bool AsyncChessboardDetector::GetLatestResult(Result& result) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!has_result_) {
+		return false;
+	}
+	result = latest_result_;
+	return true;
+}
+
+size_t AsyncChessboardDetector::GetProcessedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return processed_frame_count_;
+}
+
+size_t AsyncChessboardDetector::GetSkippedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return skipped_frame_count_;
+}
+
+size_t AsyncChessboardDetector::GetTrackedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return tracked_frame_count_;
+}
+
+size_t AsyncChessboardDetector::GetRegionDetectedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return region_detected_frame_count_;
+}
+
+size_t AsyncChessboardDetector::GetRejectedFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return rejected_frame_count_;
+}
+
+size_t AsyncChessboardDetector::GetDuplicateFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return duplicate_frame_count_;
+}
+
+void AsyncChessboardDetector::Run()
+{
+	Result last_detected_result;
+	uint64_t last_detected_hash { 0 };
+	bool has_last_detected_result { false };
+
+	for (;;) {
+		Result result;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			frame_available_.wait(lock, [this]() { return stop_ || has_pending_frame_; });
+			if (stop_) {
+				return;
+			}
+			result.image_gray = pending_image_;
+			result.frame_id = pending_frame_id_;
+			pending_image_.release();
+			has_pending_frame_ = false;
+		}
+
+		ImageQuality quality;
+		if (calibration_settings_.GetUseQualityFilter()) {
+			quality = MeasureImageQuality(result.image_gray);
+			result.quality_issue = CheckImageQuality(quality, calibration_settings_);
+			if (result.quality_issue == ImageQualityIssue::NONE && has_last_detected_result &&
+				IsDuplicateImage(quality.hash, last_detected_hash, calibration_settings_))
+			{
+				const uint64_t frame_id = result.frame_id;
+				result = last_detected_result;
+				result.frame_id = frame_id;
+				result.tracked = false;
+				result.found_in_region = false;
+				result.quality_issue = ImageQualityIssue::DUPLICATE;
+			}
+		}
+
+		if (result.quality_issue == ImageQualityIssue::NONE) {
+			Detect(result);
+			last_detected_result = result;
+			last_detected_hash = quality.hash;
+			has_last_detected_result = true;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		latest_result_ = std::move(result);
+		has_result_ = true;
+		++processed_frame_count_;
+		if (latest_result_.tracked) {
+			++tracked_frame_count_;
+		}
+		if (latest_result_.found_in_region) {
+			++region_detected_frame_count_;
+		}
+		if (latest_result_.quality_issue == ImageQualityIssue::DUPLICATE) {
+			++duplicate_frame_count_;
+		}
+		else if (latest_result_.quality_issue != ImageQualityIssue::NONE) {
+			++rejected_frame_count_;
+		}
+	}
+}
+
+void AsyncChessboardDetector::Detect(Result& result)
+{
+	// Detection errors are not expected on valid frames; a failed frame simply
+	// reports no pattern so the stream keeps running.
+	try {
+		if (calibration_settings_.GetUseCornerTracking()) {
+			result.pattern_found = tracker_.Process(result.image_gray, result.corners);
+			result.tracked = tracker_.WasLastFrameTracked();
+			result.found_in_region = tracker_.WasLastFrameFoundInRegion();
+		}
+		else {
+			result.pattern_found = FindChessboardCorners(result.image_gray, calibration_settings_, result.corners);
+		}
+	}
+	catch (const cv::Exception&) {
+		tracker_.Reset();
+		result.pattern_found = false;
+		result.tracked = false;
+		result.found_in_region = false;
+		result.corners.clear();
+	}
+}
+
+} // namespace camera_calibration
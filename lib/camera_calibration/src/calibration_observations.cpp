@@ -0,0 +1,68 @@
+#include <vector>
+
+#include "camera_calibration/calibration_observations.h"
+#include "camera_calibration/camera_calibration.h"
+
+namespace camera_calibration {
+
+
+CalibrationObservations::CalibrationObservations(const std::vector<cv::Point3f>& board_points)
+	: board_points_(board_points)
+{
+}
+
+void CalibrationObservations::GetViewPoints(
+	size_t view, 
+	std::vector<cv::Point3f>& object_points, 
+	std::vector<cv::Point2f>& image_points) const
+{
+	object_points.clear();
+	image_points.clear();
+	object_points.reserve(corners_.GetViewCornerCount(view));
+	image_points.reserve(corners_.GetViewCornerCount(view));
+	for (size_t i = corners_.GetViewBegin(view); i < corners_.GetViewEnd(view); ++i) {
+		if (corners_.IsValid(i)) {
+			object_points.push_back(board_points_[corners_.GetBoardIndex(i)]);
+			image_points.push_back(corners_.GetCorner(i));
+		}
+	}
+}
+
+void CalibrationObservations::AddView(const std::vector<cv::Point2f>& corners)
+{
+	if (corners.size() != board_points_.size()) {
+		throw CameraCalibrationExeption("number of corners does not match calibration board size");
+	}
+
+	UpdateViewState(corners_.AddView(corners));
+}
+
+void CalibrationObservations::AddView(const CornerDataset& dataset, size_t view)
+{
+	for (size_t i = dataset.GetViewBegin(view); i < dataset.GetViewEnd(view); ++i) {
+		if (dataset.GetBoardIndex(i) < 0 || static_cast<size_t>(dataset.GetBoardIndex(i)) >= board_points_.size()) {
+			throw CameraCalibrationExeption("board point index is out of range");
+		}
+	}
+
+	UpdateViewState(corners_.AddView(dataset, view));
+}
+
+void CalibrationObservations::Reserve(size_t view_count)
+{
+	corners_.Reserve(view_count, view_count * board_points_.size());
+	view_complete_.reserve(view_count);
+}
+
+void CalibrationObservations::UpdateViewState(size_t view)
+{
+	size_t view_begin = corners_.GetViewBegin(view);
+	bool complete = corners_.GetViewCornerCount(view) == board_points_.size();
+	for (size_t i = view_begin; i < corners_.GetViewEnd(view); ++i) {
+		complete = complete && corners_.IsValid(i) && corners_.GetBoardIndex(i) == static_cast<int>(i - view_begin);
+	}
+	view_complete_.push_back(complete);
+}
+
+
+} // namespace camera_calibration
@@ -2,6 +2,8 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cfloat>
 #include <vector>
 
 #include <opencv2/core.hpp>
@@ -10,25 +12,93 @@
 #include <opencv2/highgui.hpp>
 
 #include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/parallel.h"
+#include "camera_calibration/mapped_file.h"
+#include "camera_calibration/camera_parameters_binary.h"
+#include "camera_calibration/undistortion.h"
+#include "camera_calibration/sparse_calibration.h"
+#include "camera_calibration/chessboard_detection.h"
+#include "camera_calibration/corner_refinement.h"
 
 namespace camera_calibration {
 
 
+namespace {
+
+int GetCalibrationFlags(DistortionModel distortion_model)
+{
+	switch (distortion_model) {
+	case DistortionModel::REDUCED:
+		return cv::CALIB_FIX_K3;
+	case DistortionModel::RATIONAL:
+		return cv::CALIB_RATIONAL_MODEL;
+	default:
+		return 0;
+	}
+}
+
+} // namespace
+
+
 cv::Mat CameraParameters::GetCameraMatrix() const { return camera_matrix_; }
 cv::Mat CameraParameters::GetDistrotionCoefficients() const { return distortion_coefficients_; }
 std::vector<cv::Mat> CameraParameters::GetRotationVectors() const { return rotation_vectors_; }
 std::vector<cv::Mat> CameraParameters::GetTranslationVectors() const { return translation_vectors_; }
+cv::Size CameraParameters::GetImageSize() const { return image_size_; }
+double CameraParameters::GetReprojectionError() const { return reprojection_error_; }
+cv::Mat CameraParameters::GetInverseDistortionCoefficients() const { return inverse_distortion_coefficients_; }
+double CameraParameters::GetInverseDistortionMaxError() const { return inverse_distortion_max_error_; }
+double CameraParameters::GetInverseDistortionRmsError() const { return inverse_distortion_rms_error_; }
 
-void CameraParameters::SetCameraMatrix(const cv::Mat& camera_matrix) { camera_matrix_ = camera_matrix; };
-void CameraParameters::SetDistrotionCoefficients(const cv::Mat& distortion_coefficients) { distortion_coefficients_ = distortion_coefficients; };
+void CameraParameters::SetCameraMatrix(const cv::Mat& camera_matrix) { 
+	camera_matrix_ = camera_matrix; 
+	optimal_camera_matrix_cache_ = std::make_shared<OptimalCameraMatrixCache>();
+};
+void CameraParameters::SetDistrotionCoefficients(const cv::Mat& distortion_coefficients) { 
+	distortion_coefficients_ = distortion_coefficients; 
+	optimal_camera_matrix_cache_ = std::make_shared<OptimalCameraMatrixCache>();
+};
 void CameraParameters::SetRotationVectors(const std::vector<cv::Mat>& rotation_vectors) { rotation_vectors_ = rotation_vectors; };
 void CameraParameters::SetTranslationVectors(const std::vector<cv::Mat>& translation_vectors) { translation_vectors_ = translation_vectors; };
+void CameraParameters::SetImageSize(const cv::Size& image_size) { image_size_ = image_size; };
+void CameraParameters::SetReprojectionError(const double& reprojection_error) { reprojection_error_ = reprojection_error; };
+void CameraParameters::SetInverseDistortionCoefficients(const cv::Mat& inverse_distortion_coefficients) { 
+	inverse_distortion_coefficients_ = inverse_distortion_coefficients; 
+};
+void CameraParameters::SetInverseDistortionMaxError(const double& inverse_distortion_max_error) { 
+	inverse_distortion_max_error_ = inverse_distortion_max_error; 
+};
+void CameraParameters::SetInverseDistortionRmsError(const double& inverse_distortion_rms_error) { 
+	inverse_distortion_rms_error_ = inverse_distortion_rms_error; 
+};
+
+cv::Mat CameraParameters::GetOptimalNewCameraMatrix(const cv::Size& image_size) const
+{
+	std::lock_guard<std::mutex> lock(optimal_camera_matrix_cache_->mutex);
+
+	cv::Mat& optimal_camera_matrix = 
+		optimal_camera_matrix_cache_->matrices[std::make_pair(image_size.width, image_size.height)];
+	if (optimal_camera_matrix.empty()) {
+		optimal_camera_matrix = 
+			cv::getOptimalNewCameraMatrix(camera_matrix_, distortion_coefficients_, image_size, 1.0);
+	}
+
+	return optimal_camera_matrix;
+}
 
 bool CameraParameters::LoadFromFile(const std::string& filename)
 {
+	{
+		MappedFile file;
+		if (file.Open(filename) && IsCameraParametersBinary(file.GetData(), file.GetSize())) {
+			return ReadCameraParametersBinary(file, *this);
+		}
+	}
+
 	std::ifstream fin(filename);
 
 	if (fin.is_open()) {
+		optimal_camera_matrix_cache_ = std::make_shared<OptimalCameraMatrixCache>();
 		double buffer { 0.0f };
 		uint16_t rows;
 		uint16_t columns;
@@ -55,6 +125,22 @@ bool CameraParameters::LoadFromFile(const std::string& filename)
 			}
 		}
 
+		inverse_distortion_coefficients_.release();
+		inverse_distortion_max_error_ = 0.0;
+		inverse_distortion_rms_error_ = 0.0;
+		if (fin >> rows >> columns) {
+			inverse_distortion_coefficients_ = cv::Mat::zeros(rows, columns, CV_64F);
+			for (int row = 0; row < rows; ++row) {
+				for (int col = 0; col < columns; ++col) {
+					buffer = 0.0f;
+					fin >> buffer;
+					inverse_distortion_coefficients_.at<double>(row, col) = buffer;
+				}
+			}
+			fin >> inverse_distortion_max_error_;
+			fin >> inverse_distortion_rms_error_;
+		}
+
 		fin.close();
 		return true;
 	}
@@ -62,8 +148,12 @@ bool CameraParameters::LoadFromFile(const std::string& filename)
 	return false;
 }
 
-bool CameraParameters::SaveToFile(const std::string& filename) const
+bool CameraParameters::SaveToFile(const std::string& filename, CameraParametersFileFormat format) const
 {
+	if (format == CameraParametersFileFormat::BINARY) {
+		return WriteCameraParametersBinary(filename, *this);
+	}
+
 	std::ofstream fout(filename);
 	if (fout.is_open()) {
 		double buffer { 0.0f };
@@ -92,6 +182,21 @@ bool CameraParameters::SaveToFile(const std::string& filename) const
 			}
 		}
 
+		if (!inverse_distortion_coefficients_.empty()) {
+			rows = inverse_distortion_coefficients_.rows;
+			columns = inverse_distortion_coefficients_.cols;
+			fout << rows << std::endl;
+			fout << columns << std::endl;
+			for (int row = 0; row < rows; ++row) {
+				for (int col = 0; col < columns; ++col) {
+					buffer = inverse_distortion_coefficients_.at<double>(row, col);
+					fout << buffer << std::endl;
+				}
+			}
+			fout << inverse_distortion_max_error_ << std::endl;
+			fout << inverse_distortion_rms_error_ << std::endl;
+		}
+
 		fout.close();
 		return true;
 	}
@@ -146,7 +251,23 @@ void CameraCalibrationSettingsHandler::CreateSettingsFile()
         { "distance_between_points", settings.distance_between_points_ },
 		{ "image_source_type", settings.image_source_type_ },
         { "image_source_path", settings.image_source_path_ },
-        { "camera_parameters_file_path", settings.camera_parameters_file_path_ }
+        { "camera_parameters_file_path", settings.camera_parameters_file_path_ },
+        { "camera_parameters_file_format", "text" },
+        { "profile", "balanced" },
+        { "thread_count", settings.thread_count_ },
+        { "decode_scale", settings.decode_scale_ },
+        { "use_detection_cache", settings.use_detection_cache_ },
+        { "use_corner_tracking", settings.use_corner_tracking_ },
+        { "expected_square_size", settings.expected_square_size_ },
+        { "use_quality_filter", settings.use_quality_filter_ },
+        { "min_sharpness", settings.min_sharpness_ },
+        { "max_clipped_fraction", settings.max_clipped_fraction_ },
+        { "duplicate_hash_distance", settings.duplicate_hash_distance_ },
+        { "subpix_window_size", settings.search_windows_size_.width },
+        { "subpix_zero_zone_size", settings.zero_zone_size_.width },
+        { "use_subpix_kernels", settings.use_subpix_kernels_ },
+        { "scale_subpix_criteria", settings.scale_subpix_criteria_ },
+        { "calibration_solver", "opencv" }
     };
 
     std::ofstream fout(calibration_setting_file_path);
@@ -173,9 +294,149 @@ CameraCalibrationSettings
 		}
 		settings.image_source_path_ = camera_calibration_settings["image_source_path"].get<std::string>();
 		settings.camera_parameters_file_path_ = camera_calibration_settings["camera_parameters_file_path"].get<std::string>();
+		// The profile goes first so that the keys below override its values.
+		if (camera_calibration_settings.contains("profile")) {
+			std::string profile = camera_calibration_settings["profile"].get<std::string>();
+			if (profile == "fast") {
+				settings.SetPerformanceProfile(PerformanceProfile::FAST);
+			}
+			else if (profile == "balanced") {
+				settings.SetPerformanceProfile(PerformanceProfile::BALANCED);
+			}
+			else if (profile == "accurate") {
+				settings.SetPerformanceProfile(PerformanceProfile::ACCURATE);
+			}
+			else {
+				throw CameraCalibrationExeption("unsupported profile (available: fast, balanced, accurate)");
+			}
+		}
+		if (camera_calibration_settings.contains("camera_parameters_file_format")) {
+			std::string file_format = camera_calibration_settings["camera_parameters_file_format"].get<std::string>();
+			if (file_format == "text") {
+				settings.camera_parameters_file_format_ = CameraParametersFileFormat::TEXT;
+			}
+			else if (file_format == "binary") {
+				settings.camera_parameters_file_format_ = CameraParametersFileFormat::BINARY;
+			}
+			else {
+				throw CameraCalibrationExeption("unsupported camera parameters file format");
+			}
+		}
+		if (camera_calibration_settings.contains("thread_count")) {
+			settings.SetThreadCount(camera_calibration_settings["thread_count"].get<int>());
+		}
+		if (camera_calibration_settings.contains("decode_scale")) {
+			settings.SetDecodeScale(camera_calibration_settings["decode_scale"].get<int>());
+		}
+		if (camera_calibration_settings.contains("use_detection_cache")) {
+			settings.SetUseDetectionCache(camera_calibration_settings["use_detection_cache"].get<bool>());
+		}
+		if (camera_calibration_settings.contains("use_corner_tracking")) {
+			settings.SetUseCornerTracking(camera_calibration_settings["use_corner_tracking"].get<bool>());
+		}
+		if (camera_calibration_settings.contains("expected_square_size")) {
+			settings.SetExpectedSquareSize(camera_calibration_settings["expected_square_size"].get<int>());
+		}
+		if (camera_calibration_settings.contains("detection_cascade")) {
+			std::vector<DetectionStage> detection_cascade;
+			for (const auto& stage_name : camera_calibration_settings["detection_cascade"]) {
+				DetectionStage stage;
+				if (!ParseDetectionStageName(stage_name.get<std::string>(), stage)) {
+					throw CameraCalibrationExeption("unsupported detection stage");
+				}
+				detection_cascade.push_back(stage);
+			}
+			settings.SetDetectionCascade(detection_cascade);
+		}
+		if (camera_calibration_settings.contains("use_quality_filter")) {
+			settings.SetUseQualityFilter(camera_calibration_settings["use_quality_filter"].get<bool>());
+		}
+		if (camera_calibration_settings.contains("min_sharpness")) {
+			settings.SetMinSharpness(camera_calibration_settings["min_sharpness"].get<double>());
+		}
+		if (camera_calibration_settings.contains("max_clipped_fraction")) {
+			settings.SetMaxClippedFraction(camera_calibration_settings["max_clipped_fraction"].get<double>());
+		}
+		if (camera_calibration_settings.contains("duplicate_hash_distance")) {
+			settings.SetDuplicateHashDistance(camera_calibration_settings["duplicate_hash_distance"].get<int>());
+		}
+		if (camera_calibration_settings.contains("subpix_window_size")) {
+			int window_size = camera_calibration_settings["subpix_window_size"].get<int>();
+			settings.SetSearchWindowSize(cv::Size(window_size, window_size));
+		}
+		if (camera_calibration_settings.contains("max_subpix_window_size")) {
+			settings.SetMaxSearchWindowSize(camera_calibration_settings["max_subpix_window_size"].get<int>());
+		}
+		if (camera_calibration_settings.contains("subpix_zero_zone_size")) {
+			int zero_zone_size = camera_calibration_settings["subpix_zero_zone_size"].get<int>();
+			settings.SetZeroZoneSize(cv::Size(zero_zone_size, zero_zone_size));
+		}
+		if (camera_calibration_settings.contains("use_subpix_kernels")) {
+			settings.SetUseSubPixKernels(camera_calibration_settings["use_subpix_kernels"].get<bool>());
+		}
+		if (camera_calibration_settings.contains("subpix_max_iterations") || 
+			camera_calibration_settings.contains("subpix_epsilon")) 
+		{
+			cv::TermCriteria accuracy_criteria = settings.GetAccuracyCriteria();
+			if (camera_calibration_settings.contains("subpix_max_iterations")) {
+				accuracy_criteria.maxCount = camera_calibration_settings["subpix_max_iterations"].get<int>();
+			}
+			if (camera_calibration_settings.contains("subpix_epsilon")) {
+				accuracy_criteria.epsilon = camera_calibration_settings["subpix_epsilon"].get<double>();
+			}
+			settings.SetAccuracyCriteria(accuracy_criteria);
+		}
+		if (camera_calibration_settings.contains("scale_subpix_criteria")) {
+			settings.SetScaleSubPixCriteria(camera_calibration_settings["scale_subpix_criteria"].get<bool>());
+		}
+		if (camera_calibration_settings.contains("calibration_solver")) {
+			std::string calibration_solver = camera_calibration_settings["calibration_solver"].get<std::string>();
+			if (calibration_solver == "opencv") {
+				settings.calibration_solver_ = CalibrationSolver::OPENCV;
+			}
+			else if (calibration_solver == "sparse") {
+				settings.calibration_solver_ = CalibrationSolver::SPARSE;
+			}
+			else {
+				throw CameraCalibrationExeption("unsupported calibration solver");
+			}
+		}
+		if (camera_calibration_settings.contains("distortion_model")) {
+			std::string distortion_model = camera_calibration_settings["distortion_model"].get<std::string>();
+			if (distortion_model == "reduced") {
+				settings.SetDistortionModel(DistortionModel::REDUCED);
+			}
+			else if (distortion_model == "standard") {
+				settings.SetDistortionModel(DistortionModel::STANDARD);
+			}
+			else if (distortion_model == "rational") {
+				settings.SetDistortionModel(DistortionModel::RATIONAL);
+			}
+			else {
+				throw CameraCalibrationExeption("unsupported distortion model");
+			}
+		}
+		if (camera_calibration_settings.contains("solver_max_iterations") || 
+			camera_calibration_settings.contains("solver_epsilon")) 
+		{
+			cv::TermCriteria solver_criteria = settings.GetSolverCriteria();
+			if (camera_calibration_settings.contains("solver_max_iterations")) {
+				solver_criteria.maxCount = camera_calibration_settings["solver_max_iterations"].get<int>();
+			}
+			if (camera_calibration_settings.contains("solver_epsilon")) {
+				solver_criteria.epsilon = camera_calibration_settings["solver_epsilon"].get<double>();
+			}
+			settings.SetSolverCriteria(solver_criteria);
+		}
+		if (settings.calibration_solver_ == CalibrationSolver::SPARSE && 
+			settings.distortion_model_ == DistortionModel::RATIONAL) 
+		{
+			throw CameraCalibrationExeption("rational distortion model is not supported by the sparse solver");
+		}
 	}
-	catch (nlohmann::json::parse_error excpt) {
-		throw CameraCalibrationExeption("failed to parse settings");
+	catch (const nlohmann::json::exception& excpt) {
+		// Missing keys and wrongly typed values as well as parse errors.
+		throw CameraCalibrationExeption(std::string("failed to parse settings (") + excpt.what() + ")");
 	}
 
 	return settings;
@@ -184,9 +445,22 @@ CameraCalibrationSettings
 
 CameraCalibrationSettings::CameraCalibrationSettings()
 {
-	accuracy_criteria_ = cv::TermCriteria(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, 30, 0.001);
-    search_windows_size_ = cv::Size(11, 11);
-    zero_zone_size_ = cv::Size(11, 11);
+    search_windows_size_ = cv::Size(0, 0);
+    zero_zone_size_ = cv::Size(-1, -1);
+    use_subpix_kernels_ = false;
+    scale_subpix_criteria_ = false;
+    camera_parameters_file_format_ = CameraParametersFileFormat::TEXT;
+    thread_count_ = 0;
+    decode_scale_ = 1;
+    use_detection_cache_ = true;
+    use_corner_tracking_ = true;
+    expected_square_size_ = 0;
+    use_quality_filter_ = false;
+    min_sharpness_ = 20.0;
+    max_clipped_fraction_ = 0.6;
+    duplicate_hash_distance_ = 0;
+    calibration_solver_ = CalibrationSolver::OPENCV;
+    SetPerformanceProfile(PerformanceProfile::BALANCED);
 }
 
 CameraCalibrationSettings& CameraCalibrationSettings::operator=(const CameraCalibrationSettings& calibration_settings)
@@ -201,10 +475,29 @@ CameraCalibrationSettings& CameraCalibrationSettings::operator=(const CameraCali
 	image_source_type_= calibration_settings.image_source_type_;
     image_source_path_= calibration_settings.image_source_path_;
     camera_parameters_file_path_= calibration_settings.camera_parameters_file_path_;
+    camera_parameters_file_format_ = calibration_settings.camera_parameters_file_format_;
+    thread_count_ = calibration_settings.thread_count_;
+    decode_scale_ = calibration_settings.decode_scale_;
+    use_detection_cache_ = calibration_settings.use_detection_cache_;
+    use_corner_tracking_ = calibration_settings.use_corner_tracking_;
+    expected_square_size_ = calibration_settings.expected_square_size_;
+    detection_cascade_ = calibration_settings.detection_cascade_;
+    use_quality_filter_ = calibration_settings.use_quality_filter_;
+    min_sharpness_ = calibration_settings.min_sharpness_;
+    max_clipped_fraction_ = calibration_settings.max_clipped_fraction_;
+    duplicate_hash_distance_ = calibration_settings.duplicate_hash_distance_;
+    calibration_solver_ = calibration_settings.calibration_solver_;
 
     accuracy_criteria_= calibration_settings.accuracy_criteria_;
     search_windows_size_= calibration_settings.search_windows_size_;
+    max_search_window_size_ = calibration_settings.max_search_window_size_;
     zero_zone_size_= calibration_settings.zero_zone_size_;
+    use_subpix_kernels_ = calibration_settings.use_subpix_kernels_;
+    scale_subpix_criteria_ = calibration_settings.scale_subpix_criteria_;
+
+    performance_profile_ = calibration_settings.performance_profile_;
+    distortion_model_ = calibration_settings.distortion_model_;
+    solver_criteria_ = calibration_settings.solver_criteria_;
 
 	return *this;
 }
@@ -215,6 +508,29 @@ double CameraCalibrationSettings::GetDistanceBetweenPoints() const { return dist
 std::string CameraCalibrationSettings::GetImageSourceType() const { return image_source_type_; }
 std::string CameraCalibrationSettings::GetImageSourcePath() const { return image_source_path_; }
 std::string CameraCalibrationSettings::GetCameraParametersFilePath() const { return camera_parameters_file_path_; }
+CameraParametersFileFormat CameraCalibrationSettings::GetCameraParametersFileFormat() const { 
+	return camera_parameters_file_format_; 
+}
+int CameraCalibrationSettings::GetThreadCount() const { return thread_count_; }
+int CameraCalibrationSettings::GetDecodeScale() const { return decode_scale_; }
+bool CameraCalibrationSettings::GetUseDetectionCache() const { return use_detection_cache_; }
+bool CameraCalibrationSettings::GetUseCornerTracking() const { return use_corner_tracking_; }
+int CameraCalibrationSettings::GetExpectedSquareSize() const { return expected_square_size_; }
+std::vector<DetectionStage> CameraCalibrationSettings::GetDetectionCascade() const { return detection_cascade_; }
+bool CameraCalibrationSettings::GetUseQualityFilter() const { return use_quality_filter_; }
+double CameraCalibrationSettings::GetMinSharpness() const { return min_sharpness_; }
+double CameraCalibrationSettings::GetMaxClippedFraction() const { return max_clipped_fraction_; }
+int CameraCalibrationSettings::GetDuplicateHashDistance() const { return duplicate_hash_distance_; }
+CalibrationSolver CameraCalibrationSettings::GetCalibrationSolver() const { return calibration_solver_; }
+cv::TermCriteria CameraCalibrationSettings::GetAccuracyCriteria() const { return accuracy_criteria_; }
+cv::Size CameraCalibrationSettings::GetSearchWindowSize() const { return search_windows_size_; }
+int CameraCalibrationSettings::GetMaxSearchWindowSize() const { return max_search_window_size_; }
+cv::Size CameraCalibrationSettings::GetZeroZoneSize() const { return zero_zone_size_; }
+bool CameraCalibrationSettings::GetUseSubPixKernels() const { return use_subpix_kernels_; }
+bool CameraCalibrationSettings::GetScaleSubPixCriteria() const { return scale_subpix_criteria_; }
+PerformanceProfile CameraCalibrationSettings::GetPerformanceProfile() const { return performance_profile_; }
+DistortionModel CameraCalibrationSettings::GetDistortionModel() const { return distortion_model_; }
+cv::TermCriteria CameraCalibrationSettings::GetSolverCriteria() const { return solver_criteria_; }
 
 void CameraCalibrationSettings::SetCalibrationGridPattern(const std::string& calibration_grid_pattern) {
 	if (calibration_grid_pattern != "chessboard") {
@@ -240,67 +556,472 @@ void CameraCalibrationSettings::SetImageSourcePath(const std::string& image_sour
 void CameraCalibrationSettings::SetCameraParametersFilePath(const std::string& camera_parameters_file_path) { 
 	camera_parameters_file_path_ = camera_parameters_file_path; 
 }
+void CameraCalibrationSettings::SetCameraParametersFileFormat(const CameraParametersFileFormat& camera_parameters_file_format) { 
+	camera_parameters_file_format_ = camera_parameters_file_format; 
+}
+void CameraCalibrationSettings::SetThreadCount(const int& thread_count) {
+	if (thread_count < 0) {
+		throw CameraCalibrationExeption("thread count must not be negative");
+	}
+	thread_count_ = thread_count;
+}
+void CameraCalibrationSettings::SetDecodeScale(const int& decode_scale) {
+	if (decode_scale != 1 && decode_scale != 2 && decode_scale != 4 && decode_scale != 8) {
+		throw CameraCalibrationExeption("unsupported decode scale (available: 1, 2, 4, 8)");
+	}
+	decode_scale_ = decode_scale;
+}
+void CameraCalibrationSettings::SetUseDetectionCache(const bool& use_detection_cache) {
+	use_detection_cache_ = use_detection_cache;
+}
+void CameraCalibrationSettings::SetUseCornerTracking(const bool& use_corner_tracking) {
+	use_corner_tracking_ = use_corner_tracking;
+}
+void CameraCalibrationSettings::SetExpectedSquareSize(const int& expected_square_size) {
+	if (expected_square_size < 0) {
+		throw CameraCalibrationExeption("expected square size must not be negative");
+	}
+	expected_square_size_ = expected_square_size;
+}
+void CameraCalibrationSettings::SetDetectionCascade(const std::vector<DetectionStage>& detection_cascade) {
+	bool has_detection_stage { false };
+	for (size_t i { 0 }; i < detection_cascade.size(); ++i) {
+		if (std::find(detection_cascade.begin(), detection_cascade.begin() + i, detection_cascade[i]) != 
+			detection_cascade.begin() + i) 
+		{
+			throw CameraCalibrationExeption("detection stage is listed more than once");
+		}
+		has_detection_stage = has_detection_stage || detection_cascade[i] != DetectionStage::FAST_CHECK;
+	}
+	if (!has_detection_stage) {
+		throw CameraCalibrationExeption("detection cascade has no detection stage");
+	}
+	detection_cascade_ = detection_cascade;
+}
+void CameraCalibrationSettings::SetUseQualityFilter(const bool& use_quality_filter) {
+	use_quality_filter_ = use_quality_filter;
+}
+void CameraCalibrationSettings::SetMinSharpness(const double& min_sharpness) {
+	if (min_sharpness < 0.0) {
+		throw CameraCalibrationExeption("minimum sharpness must not be negative");
+	}
+	min_sharpness_ = min_sharpness;
+}
+void CameraCalibrationSettings::SetMaxClippedFraction(const double& max_clipped_fraction) {
+	if (max_clipped_fraction < 0.0 || max_clipped_fraction > 1.0) {
+		throw CameraCalibrationExeption("maximum clipped fraction must be between 0 and 1");
+	}
+	max_clipped_fraction_ = max_clipped_fraction;
+}
+void CameraCalibrationSettings::SetDuplicateHashDistance(const int& duplicate_hash_distance) {
+	if (duplicate_hash_distance < 0 || duplicate_hash_distance > 64) {
+		throw CameraCalibrationExeption("duplicate hash distance must be between 0 and 64");
+	}
+	duplicate_hash_distance_ = duplicate_hash_distance;
+}
+void CameraCalibrationSettings::SetCalibrationSolver(const CalibrationSolver& calibration_solver) {
+	calibration_solver_ = calibration_solver;
+}
+void CameraCalibrationSettings::SetAccuracyCriteria(const cv::TermCriteria& accuracy_criteria) {
+	if (accuracy_criteria.maxCount <= 0 || accuracy_criteria.epsilon <= 0.0) {
+		throw CameraCalibrationExeption("sub-pixel iteration count and epsilon must be positive");
+	}
+	accuracy_criteria_ = accuracy_criteria;
+}
+void CameraCalibrationSettings::SetSearchWindowSize(const cv::Size& search_window_size) {
+	if (search_window_size.width < 0 || search_window_size.height < 0) {
+		throw CameraCalibrationExeption("sub-pixel window size must not be negative");
+	}
+	search_windows_size_ = search_window_size;
+}
+void CameraCalibrationSettings::SetMaxSearchWindowSize(const int& max_search_window_size) {
+	if (max_search_window_size < 1) {
+		throw CameraCalibrationExeption("maximum sub-pixel window size must be positive");
+	}
+	max_search_window_size_ = max_search_window_size;
+}
+void CameraCalibrationSettings::SetZeroZoneSize(const cv::Size& zero_zone_size) {
+	if (zero_zone_size.width < -1 || zero_zone_size.height < -1) {
+		throw CameraCalibrationExeption("sub-pixel zero zone size must be -1 (none) or more");
+	}
+	zero_zone_size_ = zero_zone_size;
+}
+void CameraCalibrationSettings::SetUseSubPixKernels(const bool& use_subpix_kernels) {
+	use_subpix_kernels_ = use_subpix_kernels;
+}
+void CameraCalibrationSettings::SetScaleSubPixCriteria(const bool& scale_subpix_criteria) {
+	scale_subpix_criteria_ = scale_subpix_criteria;
+}
+void CameraCalibrationSettings::SetPerformanceProfile(const PerformanceProfile& performance_profile) {
+	// Profiles leave the calibration solver, the sub-pixel kernels and the criteria
+	// scaling alone: OPENCV, cv::cornerSubPix and the profile criteria stay in use
+	// unless selected.
+	switch (performance_profile) {
+	case PerformanceProfile::FAST:
+		// Boards the fast check misses are given up for speed, no quad filtering or
+		// equalized retry, a small refinement window and a 4-coefficient model that
+		// converges in few solver iterations.
+		detection_cascade_ = { DetectionStage::FAST_CHECK, DetectionStage::PLAIN, DetectionStage::ADAPTIVE };
+		max_search_window_size_ = 5;
+		accuracy_criteria_ = cv::TermCriteria(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, 10, 0.01);
+		distortion_model_ = DistortionModel::REDUCED;
+		solver_criteria_ = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 1e-6);
+		break;
+	case PerformanceProfile::ACCURATE:
+		detection_cascade_ = { 
+			DetectionStage::PLAIN, 
+			DetectionStage::ADAPTIVE, 
+			DetectionStage::FILTER_QUADS, 
+			DetectionStage::EQUALIZED };
+		max_search_window_size_ = 15;
+		accuracy_criteria_ = cv::TermCriteria(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, 100, 0.0001);
+		distortion_model_ = DistortionModel::STANDARD;
+		solver_criteria_ = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, DBL_EPSILON);
+		break;
+	default:
+		// No fast check: it rejects some low-contrast boards the ADAPTIVE stage finds,
+		// and that stage alone found every board before the cascade existed.
+		// cv::calibrateCamera defaults for the solver.
+		detection_cascade_ = { 
+			DetectionStage::PLAIN, 
+			DetectionStage::ADAPTIVE, 
+			DetectionStage::FILTER_QUADS, 
+			DetectionStage::EQUALIZED };
+		max_search_window_size_ = 11;
+		accuracy_criteria_ = cv::TermCriteria(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, 30, 0.001);
+		distortion_model_ = DistortionModel::STANDARD;
+		solver_criteria_ = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, DBL_EPSILON);
+		break;
+	}
+	performance_profile_ = performance_profile;
+}
+void CameraCalibrationSettings::SetDistortionModel(const DistortionModel& distortion_model) {
+	distortion_model_ = distortion_model;
+}
+void CameraCalibrationSettings::SetSolverCriteria(const cv::TermCriteria& solver_criteria) {
+	if (solver_criteria.maxCount <= 0 || solver_criteria.epsilon <= 0.0) {
+		throw CameraCalibrationExeption("solver iteration count and epsilon must be positive");
+	}
+	solver_criteria_ = solver_criteria;
+}
 
 
+CameraCalibration::CameraCalibration(const CameraCalibrationSettings& calibration_settings)
+{
+	calibration_settings_ = calibration_settings;
+	coverage_grid_.assign(kCoverageGridSize * kCoverageGridSize, false);
+
+	CalculateReferenceGridPoints();
+}
+
 CameraCalibration::CameraCalibration(
 	const CameraCalibrationSettings& calibration_settings,
     const std::vector<cv::Mat>& calibration_images_bgr) 
+	: CameraCalibration(calibration_settings)
+{
+	AddViews(calibration_images_bgr);
+	Solve();
+}
+
+CameraCalibration::CameraCalibration(
+	const CameraCalibrationSettings& calibration_settings,
+	const std::vector<std::vector<cv::Point2f>>& image_points,
+	const cv::Size& image_size)
+	: CameraCalibration(calibration_settings)
 {
-	calibration_images_.resize(calibration_images_bgr.size());
-	for (int i { 0 }; i < calibration_images_bgr.size(); ++i) {
-		cv::cvtColor(calibration_images_bgr[i], calibration_images_[i], cv::COLOR_BGR2GRAY);
+	for (const auto& corners : image_points) {
+		AddDetections(corners, image_size);
 	}
-	calibration_settings_ = calibration_settings;
+	Solve();
+}
 
-	CalculateReferenceGridPoints();
-	CalculateRealChessboardPoints();
-	
-	reference_points_.resize(real_points_.size(), reference_points_[0]);
-	camera_parameters_.distortion_coefficients_ = cv::Mat::zeros(8, 1, CV_64F);
+bool CameraCalibration::AddView(const cv::Mat& image)
+{
+	cv::Mat image_gray;
+	if (image.channels() == 1) {
+		image_gray = image;
+	}
+	else {
+		cv::cvtColor(image, image_gray, cv::COLOR_BGR2GRAY);
+	}
+
+	std::vector<cv::Point2f> corners;
+	if (!DetectChessboardCorners(image_gray, calibration_settings_, corners)) {
+		return false;
+	}
+
+	AddDetections(corners, image_gray.size());
+	return true;
+}
+
+size_t CameraCalibration::AddViews(const std::vector<cv::Mat>& images)
+{
+	std::vector<std::vector<cv::Point2f>> corners_buffers(images.size());
+	std::vector<char> pattern_found(images.size(), false);
+
+	ParallelFor(images.size(), calibration_settings_.thread_count_, [&](size_t image_index) {
+		cv::Mat image_gray;
+		if (images[image_index].channels() == 1) {
+			image_gray = images[image_index];
+		}
+		else {
+			cv::cvtColor(images[image_index], image_gray, cv::COLOR_BGR2GRAY);
+		}
+		pattern_found[image_index] = DetectChessboardCorners(
+			image_gray, 
+			calibration_settings_, 
+			corners_buffers[image_index]);
+	});
+
+	size_t added_view_count { 0 };
+	for (size_t image_index { 0 }; image_index < images.size(); ++image_index) {
+		if (pattern_found[image_index]) {
+			AddDetections(corners_buffers[image_index], images[image_index].size());
+			++added_view_count;
+		}
+	}
+
+	return added_view_count;
+}
+
+void CameraCalibration::AddDetections(const std::vector<cv::Point2f>& corners, const cv::Size& image_size)
+{
+	if (corners.size() != observations_.GetBoardPoints().size()) {
+		throw CameraCalibrationExeption("number of corners does not match calibration board size");
+	}
+	SetImageSize(image_size);
+
+	observations_.AddView(corners);
+	UpdateCoverage(observations_.GetViewCount() - 1);
+}
+
+void CameraCalibration::AddDetections(const CornerDataset& detections, const cv::Size& image_size)
+{
+	if (detections.GetViewCount() == 0) {
+		return;
+	}
+	SetImageSize(image_size);
+
+	for (size_t view { 0 }; view < detections.GetViewCount(); ++view) {
+		observations_.AddView(detections, view);
+		UpdateCoverage(observations_.GetViewCount() - 1);
+	}
+}
+
+void CameraCalibration::SetImageSize(const cv::Size& image_size)
+{
+	if (image_size.empty()) {
+		throw CameraCalibrationExeption("image size is not specified");
+	}
+	if (image_size_.empty()) {
+		image_size_ = image_size;
+	}
+	else if (image_size_ != image_size) {
+		throw CameraCalibrationExeption("calibration images have different sizes");
+	}
+}
 
-	cv::calibrateCamera(
-		reference_points_, 
-		real_points_, 
-		calibration_settings_.calibration_board_size_, 
-		camera_parameters_.camera_matrix_, 
-		camera_parameters_.distortion_coefficients_, 
-		camera_parameters_.rotation_vectors_, 
-		camera_parameters_.translation_vectors_);
+double CameraCalibration::GetCoverage() const
+{
+	size_t covered_cell_count = std::count(coverage_grid_.begin(), coverage_grid_.end(), true);
+	return static_cast<double>(covered_cell_count) / coverage_grid_.size();
+}
+
+void CameraCalibration::UpdateCoverage(size_t view)
+{
+	const CornerDataset& corners = observations_.GetCorners();
+	for (size_t i = corners.GetViewBegin(view); i < corners.GetViewEnd(view); ++i) {
+		if (!corners.IsValid(i)) {
+			continue;
+		}
+		int column = static_cast<int>(corners.GetX()[i] * kCoverageGridSize / image_size_.width);
+		int row = static_cast<int>(corners.GetY()[i] * kCoverageGridSize / image_size_.height);
+		column = std::min(std::max(column, 0), kCoverageGridSize - 1);
+		row = std::min(std::max(row, 0), kCoverageGridSize - 1);
+		coverage_grid_[row * kCoverageGridSize + column] = true;
+	}
+}
+
+CameraParameters CameraCalibration::Solve()
+{
+	camera_parameters_ = Calibrate(calibration_settings_, observations_, image_size_);
+	return camera_parameters_;
+}
+
+std::future<CameraParameters> CameraCalibration::SolveAsync() const
+{
+	return std::async(
+		std::launch::async, 
+		&CameraCalibration::Calibrate, 
+		calibration_settings_, 
+		observations_, 
+		image_size_);
+}
+
+CameraParameters CameraCalibration::Calibrate(
+	const CameraCalibrationSettings& calibration_settings,
+	const CalibrationObservations& observations,
+	const cv::Size& image_size)
+{
+	if (observations.GetViewCount() == 0) {
+		throw CameraCalibrationExeption("calibration pattern was not found on any image");
+	}
+
+	CameraParameters camera_parameters;
+	camera_parameters.distortion_coefficients_ = cv::Mat::zeros(8, 1, CV_64F);
+	camera_parameters.image_size_ = image_size;
+
+	if (calibration_settings.calibration_solver_ == CalibrationSolver::SPARSE) {
+		camera_parameters.reprojection_error_ = CalibrateCameraSparse(
+			observations, 
+			image_size, 
+			camera_parameters.camera_matrix_, 
+			camera_parameters.distortion_coefficients_, 
+			camera_parameters.rotation_vectors_, 
+			camera_parameters.translation_vectors_,
+			calibration_settings.thread_count_,
+			calibration_settings.solver_criteria_,
+			GetCalibrationFlags(calibration_settings.distortion_model_));
+	}
+	else {
+		// calibrateCamera wants interleaved points per view. The valid corners of all views
+		// are interleaved into one buffer and every view gets a Mat header into it; views
+		// that see the whole board share one header over the board model, the object
+		// points of the other views are gathered into a second buffer. Corner weights are
+		// not supported by calibrateCamera and are ignored here.
+		const std::vector<cv::Point3f>& board_points = observations.GetBoardPoints();
+		cv::Mat board(static_cast<int>(board_points.size()), 1, CV_32FC3, const_cast<cv::Point3f*>(board_points.data()));
+
+		const CornerDataset& corners = observations.GetCorners();
+		const size_t view_count = observations.GetViewCount();
+		std::vector<cv::Point2f> image_point_buffer;
+		std::vector<cv::Point3f> object_point_buffer;
+		std::vector<size_t> image_point_offsets(view_count + 1, 0);
+		std::vector<size_t> object_point_offsets(view_count + 1, 0);
+		image_point_buffer.reserve(corners.GetCornerCount());
+		for (size_t view { 0 }; view < view_count; ++view) {
+			const bool complete = observations.IsViewComplete(view);
+			for (size_t i = corners.GetViewBegin(view); i < corners.GetViewEnd(view); ++i) {
+				if (!corners.IsValid(i)) {
+					continue;
+				}
+				image_point_buffer.push_back(corners.GetCorner(i));
+				if (!complete) {
+					object_point_buffer.push_back(board_points[corners.GetBoardIndex(i)]);
+				}
+			}
+			image_point_offsets[view + 1] = image_point_buffer.size();
+			object_point_offsets[view + 1] = object_point_buffer.size();
+		}
+
+		std::vector<cv::Mat> object_points(view_count);
+		std::vector<cv::Mat> image_points(view_count);
+		for (size_t view { 0 }; view < view_count; ++view) {
+			const int point_count = static_cast<int>(image_point_offsets[view + 1] - image_point_offsets[view]);
+			image_points[view] = cv::Mat(point_count, 1, CV_32FC2, image_point_buffer.data() + image_point_offsets[view]);
+			object_points[view] = observations.IsViewComplete(view) ? 
+				board : 
+				cv::Mat(point_count, 1, CV_32FC3, object_point_buffer.data() + object_point_offsets[view]);
+		}
+
+		camera_parameters.reprojection_error_ = cv::calibrateCamera(
+			object_points, 
+			image_points, 
+			image_size, 
+			camera_parameters.camera_matrix_, 
+			camera_parameters.distortion_coefficients_, 
+			camera_parameters.rotation_vectors_, 
+			camera_parameters.translation_vectors_,
+			GetCalibrationFlags(calibration_settings.distortion_model_),
+			calibration_settings.solver_criteria_);
+	}
+
+	// A model that cannot be fitted must not cost the calibration; points are then
+	// undistorted iteratively.
+	TryFitInverseDistortionModel(camera_parameters, image_size);
+
+	return camera_parameters;
 }
 
 void CameraCalibration::CalculateReferenceGridPoints()
 {
+	std::vector<cv::Point3f> reference_points;
 	for (int i { 0 }; i < calibration_settings_.calibration_board_size_.height; ++i) {
 		for (int j = 0; j < calibration_settings_.calibration_board_size_.width; ++j) {
-			reference_points_[0].push_back(cv::Point3f(
+			reference_points.push_back(cv::Point3f(
 				j * calibration_settings_.distance_between_points_, 
 				i * calibration_settings_.distance_between_points_, 
 				0.0f));
 		}
 	}
+	observations_ = CalibrationObservations(reference_points);
 }
 
-void CameraCalibration::CalculateRealChessboardPoints()
+
+bool FindChessboardCorners(
+	const cv::Mat& image_gray, 
+	const CameraCalibrationSettings& calibration_settings, 
+	std::vector<cv::Point2f>& corners)
 {
-	for (auto image_iterator = calibration_images_.begin(); image_iterator != calibration_images_.end(); ++image_iterator) {
-		std::vector<cv::Point2f> corners_buffer;
-		if (cv::findChessboardCorners(
-			*image_iterator, 
-			calibration_settings_.calibration_board_size_, 
-			corners_buffer, 
-			cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE)) 
-		{
-			cv::cornerSubPix(
-				*image_iterator,
-				corners_buffer,
-				calibration_settings_.search_windows_size_,
-				calibration_settings_.zero_zone_size_,
-				calibration_settings_.accuracy_criteria_);
-			real_points_.push_back(corners_buffer);
-		}
+	DetectionStage found_stage;
+	return FindChessboardCorners(image_gray, calibration_settings, corners, found_stage);
+}
+
+bool FindChessboardCorners(
+	const cv::Mat& image_gray, 
+	const CameraCalibrationSettings& calibration_settings, 
+	std::vector<cv::Point2f>& corners,
+	DetectionStage& found_stage)
+{
+	const cv::Size board_size = calibration_settings.GetCalibrationBoardSize();
+	return FindChessboardCornersCoarseToFine(
+		image_gray, 
+		board_size, 
+		calibration_settings.GetDetectionCascade(),
+		GetDetectionPyramidLevelCount(image_gray.size(), board_size, calibration_settings.GetExpectedSquareSize()),
+		corners,
+		found_stage);
+}
+
+void RefineChessboardCorners(
+	const cv::Mat& image_gray, 
+	const CameraCalibrationSettings& calibration_settings, 
+	std::vector<cv::Point2f>& corners,
+	int thread_count)
+{
+	if (corners.empty()) {
+		return;
 	}
+
+	const cv::Size window_size = GetRefinementWindowSize(corners, calibration_settings);
+	const cv::TermCriteria criteria = GetRefinementCriteria(corners, calibration_settings);
+	if (!calibration_settings.GetUseSubPixKernels()) {
+		cv::cornerSubPix(image_gray, corners, window_size, calibration_settings.GetZeroZoneSize(), criteria);
+		return;
+	}
+
+	RefineCornersSubPix(
+		image_gray,
+		corners.data(),
+		corners.size(),
+		window_size,
+		calibration_settings.GetZeroZoneSize(),
+		criteria,
+		thread_count);
 }
 
+bool DetectChessboardCorners(
+	const cv::Mat& image_gray, 
+	const CameraCalibrationSettings& calibration_settings, 
+	std::vector<cv::Point2f>& corners)
+{
+	if (!FindChessboardCorners(image_gray, calibration_settings, corners)) {
+		return false;
+	}
+
+	RefineChessboardCorners(image_gray, calibration_settings, corners);
+	return true;
+}
 
 void UndistortPoint (
     const cv::Point2f& src, 
@@ -308,19 +1029,33 @@ void UndistortPoint (
     const CameraParameters& camera_parameters,
     const cv::Size &image_size = cv::Size(-1, -1)) 
 {
-	std::vector<cv::Point2f> src_temp { src };
-	std::vector<cv::Point2f> dst_temp { dst };
+	UndistortPoints(&src, &dst, 1, camera_parameters, image_size);
+}
+
+void UndistortPoints(
+	const cv::Point2f* src, 
+	cv::Point2f* dst, 
+	size_t point_count, 
+	const CameraParameters& camera_parameters, 
+	const cv::Size& image_size)
+{
+	if (point_count == 0) {
+		return;
+	}
+
+	cv::Mat src_points(static_cast<int>(point_count), 1, CV_32FC2, const_cast<cv::Point2f*>(src));
+	cv::Mat dst_points(static_cast<int>(point_count), 1, CV_32FC2, dst);
 
 	if (image_size == cv::Size(-1, -1)) {	
-		cv::undistortPoints(src_temp, dst_temp, camera_parameters.GetCameraMatrix(), camera_parameters.GetDistrotionCoefficients());
+		cv::undistortPoints(src_points, dst_points, camera_parameters.GetCameraMatrix(), camera_parameters.GetDistrotionCoefficients());
 	} 
 	else {
-		cv::Mat optimal_camera_matrix_ =
-			cv::getOptimalNewCameraMatrix(camera_parameters.GetCameraMatrix(), camera_parameters.GetDistrotionCoefficients(), image_size, 1.0);
-		cv::undistortPoints(src_temp, dst_temp, optimal_camera_matrix_, camera_parameters.GetDistrotionCoefficients());
+		cv::undistortPoints(
+			src_points, 
+			dst_points, 
+			camera_parameters.GetOptimalNewCameraMatrix(image_size), 
+			camera_parameters.GetDistrotionCoefficients());
 	}
-
-	dst = dst_temp[0];
 }
 
 
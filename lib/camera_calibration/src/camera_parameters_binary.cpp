@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "camera_calibration/camera_parameters_binary.h"
+#include "camera_calibration/mapped_file.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+std::vector<double> ToDoubles(const cv::Mat& matrix)
+{
+	if (matrix.empty()) {
+		return {};
+	}
+
+	cv::Mat matrix_64f;
+	matrix.convertTo(matrix_64f, CV_64F);
+	matrix_64f = matrix_64f.clone();
+	return std::vector<double>(matrix_64f.ptr<double>(), matrix_64f.ptr<double>() + matrix_64f.total());
+}
+
+std::vector<double> ToDoubles(const std::vector<cv::Mat>& vectors)
+{
+	std::vector<double> values;
+	values.reserve(3 * vectors.size());
+	for (const auto& vector : vectors) {
+		std::vector<double> vector_values = ToDoubles(vector);
+		vector_values.resize(3, 0.0);
+		values.insert(values.end(), vector_values.begin(), vector_values.end());
+	}
+	return values;
+}
+
+bool IsSectionInFile(uint64_t offset, uint64_t value_count, size_t file_size)
+{
+	return offset % sizeof(double) == 0 &&
+		offset <= file_size &&
+		value_count <= (file_size - offset) / sizeof(double);
+}
+
+cv::Mat ReadMatrix(const unsigned char* data, uint64_t offset, int rows, int cols)
+{
+	cv::Mat matrix(rows, cols, CV_64F);
+	if (!matrix.empty()) {
+		std::memcpy(matrix.data, data + offset, matrix.total() * sizeof(double));
+	}
+	return matrix;
+}
+
+} // namespace
+
+
+bool IsCameraParametersBinary(const unsigned char* data, size_t size)
+{
+	return data != nullptr &&
+		size >= sizeof(kCameraParametersBinaryMagic) &&
+		std::memcmp(data, kCameraParametersBinaryMagic, sizeof(kCameraParametersBinaryMagic)) == 0;
+}
+
+bool ReadCameraParametersBinary(const MappedFile& file, CameraParameters& camera_parameters)
+{
+	const unsigned char* data = file.GetData();
+	if (!IsCameraParametersBinary(data, file.GetSize()) || file.GetSize() < kCameraParametersBinaryHeaderSizeV1) {
+		return false;
+	}
+
+	// Fields newer than the file's header stay zero.
+	CameraParametersBinaryHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(&header, data, kCameraParametersBinaryHeaderSizeV1);
+	if (header.version > kCameraParametersBinaryVersion ||
+		header.header_size < kCameraParametersBinaryHeaderSizeV1 ||
+		header.header_size > file.GetSize() ||
+		header.file_size != file.GetSize())
+	{
+		return false;
+	}
+	std::memcpy(&header, data, std::min<size_t>(header.header_size, sizeof(header)));
+
+	uint64_t camera_matrix_size = static_cast<uint64_t>(header.camera_matrix_rows) * header.camera_matrix_cols;
+	uint64_t distortion_coefficients_size =
+		static_cast<uint64_t>(header.distortion_coefficients_rows) * header.distortion_coefficients_cols;
+	uint64_t view_vectors_size = 3 * static_cast<uint64_t>(header.view_count);
+
+	if (!IsSectionInFile(header.camera_matrix_offset, camera_matrix_size, file.GetSize()) ||
+		!IsSectionInFile(header.distortion_coefficients_offset, distortion_coefficients_size, file.GetSize()) ||
+		!IsSectionInFile(header.rotation_vectors_offset, view_vectors_size, file.GetSize()) ||
+		!IsSectionInFile(header.translation_vectors_offset, view_vectors_size, file.GetSize()) ||
+		!IsSectionInFile(header.inverse_distortion_coefficients_offset, header.inverse_distortion_coefficient_count, file.GetSize()))
+	{
+		return false;
+	}
+
+	std::vector<cv::Mat> rotation_vectors(header.view_count);
+	std::vector<cv::Mat> translation_vectors(header.view_count);
+	for (uint32_t view { 0 }; view < header.view_count; ++view) {
+		rotation_vectors[view] = ReadMatrix(data, header.rotation_vectors_offset + view * 3 * sizeof(double), 3, 1);
+		translation_vectors[view] = ReadMatrix(data, header.translation_vectors_offset + view * 3 * sizeof(double), 3, 1);
+	}
+
+	camera_parameters.SetCameraMatrix(ReadMatrix(
+		data, header.camera_matrix_offset, header.camera_matrix_rows, header.camera_matrix_cols));
+	camera_parameters.SetDistrotionCoefficients(ReadMatrix(
+		data, header.distortion_coefficients_offset, header.distortion_coefficients_rows, header.distortion_coefficients_cols));
+	camera_parameters.SetRotationVectors(rotation_vectors);
+	camera_parameters.SetTranslationVectors(translation_vectors);
+	camera_parameters.SetImageSize(cv::Size(header.image_width, header.image_height));
+	camera_parameters.SetReprojectionError(header.reprojection_error);
+	camera_parameters.SetInverseDistortionCoefficients(header.inverse_distortion_coefficient_count == 0 ? cv::Mat() :
+		ReadMatrix(data, header.inverse_distortion_coefficients_offset, header.inverse_distortion_coefficient_count, 1));
+	camera_parameters.SetInverseDistortionMaxError(header.inverse_distortion_max_error);
+	camera_parameters.SetInverseDistortionRmsError(header.inverse_distortion_rms_error);
+	return true;
+}
+
+bool WriteCameraParametersBinary(const std::string& filename, const CameraParameters& camera_parameters)
+{
+	cv::Mat camera_matrix = camera_parameters.GetCameraMatrix();
+	cv::Mat distortion_coefficients = camera_parameters.GetDistrotionCoefficients();
+	std::vector<double> camera_matrix_values = ToDoubles(camera_matrix);
+	std::vector<double> distortion_coefficients_values = ToDoubles(distortion_coefficients);
+	std::vector<double> rotation_vectors_values = ToDoubles(camera_parameters.GetRotationVectors());
+	std::vector<double> translation_vectors_values = ToDoubles(camera_parameters.GetTranslationVectors());
+	std::vector<double> inverse_distortion_values = ToDoubles(camera_parameters.GetInverseDistortionCoefficients());
+
+	CameraParametersBinaryHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, kCameraParametersBinaryMagic, sizeof(header.magic));
+	header.version = kCameraParametersBinaryVersion;
+	header.header_size = sizeof(header);
+
+	header.image_width = camera_parameters.GetImageSize().width;
+	header.image_height = camera_parameters.GetImageSize().height;
+	header.reprojection_error = camera_parameters.GetReprojectionError();
+
+	header.camera_matrix_rows = camera_matrix.rows;
+	header.camera_matrix_cols = camera_matrix.cols;
+	header.distortion_coefficients_rows = distortion_coefficients.rows;
+	header.distortion_coefficients_cols = distortion_coefficients.cols;
+	header.view_count = static_cast<uint32_t>(camera_parameters.GetRotationVectors().size());
+	if (camera_parameters.GetTranslationVectors().size() != header.view_count) {
+		return false;
+	}
+
+	header.camera_matrix_offset = sizeof(header);
+	header.distortion_coefficients_offset = header.camera_matrix_offset + camera_matrix_values.size() * sizeof(double);
+	header.rotation_vectors_offset = header.distortion_coefficients_offset + distortion_coefficients_values.size() * sizeof(double);
+	header.translation_vectors_offset = header.rotation_vectors_offset + rotation_vectors_values.size() * sizeof(double);
+	header.inverse_distortion_coefficients_offset = header.translation_vectors_offset + translation_vectors_values.size() * sizeof(double);
+	header.file_size = header.inverse_distortion_coefficients_offset + inverse_distortion_values.size() * sizeof(double);
+
+	header.inverse_distortion_coefficient_count = static_cast<uint32_t>(inverse_distortion_values.size());
+	header.inverse_distortion_max_error = camera_parameters.GetInverseDistortionMaxError();
+	header.inverse_distortion_rms_error = camera_parameters.GetInverseDistortionRmsError();
+
+	std::ofstream fout(filename, std::ios::binary);
+	if (!fout.is_open()) {
+		return false;
+	}
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const auto* values : {
+		&camera_matrix_values,
+		&distortion_coefficients_values,
+		&rotation_vectors_values,
+		&translation_vectors_values,
+		&inverse_distortion_values })
+	{
+		fout.write(reinterpret_cast<const char*>(values->data()), values->size() * sizeof(double));
+	}
+
+	fout.close();
+	return static_cast<bool>(fout);
+}
+
+
+} // namespace camera_calibration
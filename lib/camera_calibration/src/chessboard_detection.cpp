@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/chessboard_detection.h"
+#include "camera_calibration/corner_refinement.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+// Smallest square size in pixels findChessboardCorners handles reliably.
+const int kMinimumDetectionSquareSize { 16 };
+// Shorter side of the coarsest level is kept above this many pixels.
+const int kMinimumDetectionImageSide { 240 };
+// Assumed minimum board extent as a fraction of the shorter image side when the
+// square size is not given.
+const double kMinimumBoardImageFraction { 1.0 / 3.0 };
+
+// Local equalization used by the EQUALIZED stage. Global equalization is already
+// what CALIB_CB_NORMALIZE_IMAGE does, so the retry targets uneven lighting instead.
+const double kEqualizationClipLimit { 2.0 };
+const cv::Size kEqualizationTileGridSize { 8, 8 };
+
+const cv::TermCriteria kLevelRefinementCriteria { cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 10, 0.05 };
+const int kMaximumLevelRefinementWindow { 5 };
+
+// Refinement half window relative to the corner spacing when it is not configured.
+const float kRefinementWindowSpacingFraction { 0.3f };
+const int kMinimumRefinementWindow { 2 };
+// Corner spacing the configured accuracy criteria are meant for, about where the
+// adaptive window reaches the default cap of 11. Wider spacings get proportionally
+// looser criteria, down to a floor of iterations.
+const float kReferenceCornerSpacing { 36.0f };
+const int kMinimumRefinementIterations { 5 };
+
+int GetDetectionStageFlags(DetectionStage stage)
+{
+	switch (stage) {
+	case DetectionStage::PLAIN:
+		return 0;
+	case DetectionStage::ADAPTIVE:
+		return cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE;
+	case DetectionStage::FILTER_QUADS:
+		return cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE | cv::CALIB_CB_FILTER_QUADS;
+	case DetectionStage::EQUALIZED:
+		return cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_FILTER_QUADS;
+	default:
+		return 0;
+	}
+}
+
+bool RunDetectionCascade(
+	const cv::Mat& image_gray,
+	const cv::Size& board_size,
+	const std::vector<DetectionStage>& detection_cascade,
+	std::vector<cv::Point2f>& corners,
+	DetectionStage& found_stage)
+{
+	cv::Mat image_equalized;
+	for (DetectionStage stage : detection_cascade) {
+		if (stage == DetectionStage::FAST_CHECK) {
+			if (!cv::checkChessboard(image_gray, board_size)) {
+				return false;
+			}
+			continue;
+		}
+
+		const cv::Mat* search_image = &image_gray;
+		if (stage == DetectionStage::EQUALIZED) {
+			cv::createCLAHE(kEqualizationClipLimit, kEqualizationTileGridSize)->apply(image_gray, image_equalized);
+			search_image = &image_equalized;
+		}
+
+		if (cv::findChessboardCorners(*search_image, board_size, corners, GetDetectionStageFlags(stage))) {
+			found_stage = stage;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Stages run on the full-resolution image after the coarse level found nothing: the
+// fast check if configured, then a single detection stage, ADAPTIVE (the detection
+// used before the pyramid existed) when configured or else the first one. A board-less
+// image so costs the coarse cascade plus one full-resolution search.
+std::vector<DetectionStage> GetFallbackCascade(const std::vector<DetectionStage>& detection_cascade)
+{
+	std::vector<DetectionStage> fallback_cascade;
+	if (std::find(detection_cascade.begin(), detection_cascade.end(), DetectionStage::FAST_CHECK) != 
+		detection_cascade.end()) 
+	{
+		fallback_cascade.push_back(DetectionStage::FAST_CHECK);
+	}
+	if (std::find(detection_cascade.begin(), detection_cascade.end(), DetectionStage::ADAPTIVE) != 
+		detection_cascade.end()) 
+	{
+		fallback_cascade.push_back(DetectionStage::ADAPTIVE);
+		return fallback_cascade;
+	}
+	for (DetectionStage stage : detection_cascade) {
+		if (stage != DetectionStage::FAST_CHECK) {
+			fallback_cascade.push_back(stage);
+			break;
+		}
+	}
+	return fallback_cascade;
+}
+
+} // namespace
+
+
+int GetDetectionPyramidLevelCount(const cv::Size& image_size, const cv::Size& board_size, int expected_square_size)
+{
+	double square_size = expected_square_size;
+	if (square_size <= 0) {
+		// Outer squares included, a board of n inner corners is n + 1 squares wide.
+		int square_count = std::max(board_size.width, board_size.height) + 1;
+		square_size = kMinimumBoardImageFraction * std::min(image_size.width, image_size.height) / square_count;
+	}
+
+	int level_count { 0 };
+	int shorter_side = std::min(image_size.width, image_size.height);
+	while (square_size / 2 >= kMinimumDetectionSquareSize && shorter_side / 2 >= kMinimumDetectionImageSide) {
+		square_size /= 2;
+		shorter_side /= 2;
+		++level_count;
+	}
+	return level_count;
+}
+
+bool FindChessboardCornersCoarseToFine(
+	const cv::Mat& image_gray,
+	const cv::Size& board_size,
+	const std::vector<DetectionStage>& detection_cascade,
+	int level_count,
+	std::vector<cv::Point2f>& corners,
+	DetectionStage& found_stage)
+{
+	if (level_count <= 0) {
+		return RunDetectionCascade(image_gray, board_size, detection_cascade, corners, found_stage);
+	}
+
+	std::vector<cv::Mat> pyramid(level_count + 1);
+	pyramid[0] = image_gray;
+	for (int level { 1 }; level <= level_count; ++level) {
+		cv::pyrDown(pyramid[level - 1], pyramid[level]);
+	}
+
+	if (!RunDetectionCascade(pyramid[level_count], board_size, detection_cascade, corners, found_stage)) {
+		return RunDetectionCascade(image_gray, board_size, GetFallbackCascade(detection_cascade), corners, found_stage);
+	}
+
+	// pyrDown keeps pixel centres aligned (coarse pixel i sits on fine pixel 2i), so a
+	// corner moves down one level by doubling its coordinates. The window stays below a
+	// quarter of the square so it never reaches a neighbouring corner.
+	float square_size = GetMinimumCornerSpacing(corners, board_size);
+	for (int level { level_count - 1 }; level >= 0; --level) {
+		square_size *= 2;
+		for (cv::Point2f& corner : corners) {
+			corner *= 2.0f;
+		}
+		int window = std::max(2, std::min(kMaximumLevelRefinementWindow, static_cast<int>(square_size / 4)));
+		cv::cornerSubPix(pyramid[level], corners, cv::Size(window, window), cv::Size(-1, -1), kLevelRefinementCriteria);
+	}
+
+	return true;
+}
+
+float GetMinimumCornerSpacing(const std::vector<cv::Point2f>& corners, const cv::Size& board_size)
+{
+	float minimum_spacing = std::numeric_limits<float>::max();
+	for (int row { 0 }; row < board_size.height; ++row) {
+		for (int column { 0 }; column < board_size.width; ++column) {
+			const cv::Point2f& corner = corners[row * board_size.width + column];
+			if (column + 1 < board_size.width) {
+				cv::Point2f step = corners[row * board_size.width + column + 1] - corner;
+				minimum_spacing = std::min(minimum_spacing, std::sqrt(step.x * step.x + step.y * step.y));
+			}
+			if (row + 1 < board_size.height) {
+				cv::Point2f step = corners[(row + 1) * board_size.width + column] - corner;
+				minimum_spacing = std::min(minimum_spacing, std::sqrt(step.x * step.x + step.y * step.y));
+			}
+		}
+	}
+	return minimum_spacing;
+}
+
+cv::Size GetRefinementWindowSize(
+	const std::vector<cv::Point2f>& corners, 
+	const CameraCalibrationSettings& calibration_settings)
+{
+	const cv::Size search_window_size = calibration_settings.GetSearchWindowSize();
+	if (search_window_size.width > 0 && search_window_size.height > 0) {
+		return search_window_size;
+	}
+
+	const int maximum_window = calibration_settings.GetMaxSearchWindowSize();
+	const cv::Size board_size = calibration_settings.GetCalibrationBoardSize();
+	if (corners.size() != static_cast<size_t>(board_size.area())) {
+		return cv::Size(maximum_window, maximum_window);
+	}
+
+	const float half_window = std::max<float>(
+		kMinimumRefinementWindow, 
+		kRefinementWindowSpacingFraction * GetMinimumCornerSpacing(corners, board_size));
+	const int window = calibration_settings.GetUseSubPixKernels() ? 
+		GetSpecializedRefinementWindow(half_window, maximum_window) : 
+		std::min(maximum_window, static_cast<int>(std::lround(half_window)));
+	return cv::Size(window, window);
+}
+
+cv::TermCriteria GetRefinementCriteria(
+	const std::vector<cv::Point2f>& corners, 
+	const CameraCalibrationSettings& calibration_settings)
+{
+	cv::TermCriteria criteria = calibration_settings.GetAccuracyCriteria();
+	const cv::Size search_window_size = calibration_settings.GetSearchWindowSize();
+	const cv::Size board_size = calibration_settings.GetCalibrationBoardSize();
+	if (!calibration_settings.GetScaleSubPixCriteria() ||
+		(search_window_size.width > 0 && search_window_size.height > 0) || 
+		corners.size() != static_cast<size_t>(board_size.area())) 
+	{
+		return criteria;
+	}
+
+	// Epsilon is in pixels: on a board twice as large the same relative precision is
+	// reached at twice the step, and the corners start closer in relative terms.
+	const float scale = GetMinimumCornerSpacing(corners, board_size) / kReferenceCornerSpacing;
+	if (scale > 1.0f) {
+		criteria.epsilon *= scale;
+		criteria.maxCount = std::max(
+			std::min(criteria.maxCount, kMinimumRefinementIterations), 
+			static_cast<int>(std::lround(criteria.maxCount / scale)));
+	}
+	return criteria;
+}
+
+std::string GetDetectionStageName(DetectionStage stage)
+{
+	switch (stage) {
+	case DetectionStage::FAST_CHECK:
+		return "fast_check";
+	case DetectionStage::PLAIN:
+		return "plain";
+	case DetectionStage::ADAPTIVE:
+		return "adaptive";
+	case DetectionStage::FILTER_QUADS:
+		return "filter_quads";
+	case DetectionStage::EQUALIZED:
+		return "equalized";
+	default:
+		return "unknown";
+	}
+}
+
+bool ParseDetectionStageName(const std::string& name, DetectionStage& stage)
+{
+	const DetectionStage stages[] { 
+		DetectionStage::FAST_CHECK, 
+		DetectionStage::PLAIN, 
+		DetectionStage::ADAPTIVE, 
+		DetectionStage::FILTER_QUADS, 
+		DetectionStage::EQUALIZED };
+	for (DetectionStage candidate : stages) {
+		if (GetDetectionStageName(candidate) == name) {
+			stage = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+} // namespace camera_calibration
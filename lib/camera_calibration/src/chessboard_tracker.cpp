@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "camera_calibration/chessboard_detection.h"
+#include "camera_calibration/chessboard_tracker.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+const cv::Size kOpticalFlowWindowSize { 21, 21 };
+const int kOpticalFlowPyramidLevels { 3 };
+const cv::TermCriteria kOpticalFlowCriteria { cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 0.03 };
+
+// cornerSubPix window used to snap tracked corners, kept small so a corner cannot
+// jump to a neighbouring saddle point.
+const cv::Size kSnapWindowSize { 5, 5 };
+const cv::TermCriteria kSnapCriteria { cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 10, 0.01 };
+
+// Largest allowed difference between two consecutive spacings along a row or a
+// column, relative to their mean.
+const float kGridSpacingTolerance { 0.35f };
+// Largest allowed snap displacement relative to the smallest corner spacing.
+const float kSnapDisplacementTolerance { 0.25f };
+
+// Padding of the search region around the last board position, in board squares:
+// the crop must keep the outer squares and the white border around them.
+const float kRegionPaddingSquares { 2.0f };
+// Extra padding per pixel of board motion per frame.
+const float kRegionMotionFactor { 2.0f };
+// Frames in a row the board may be lost before its last position is forgotten.
+const int kMaximumMissedFrames { 5 };
+// Above this fraction of the frame a crop saves too little to be worth a second try.
+const float kMaximumRegionAreaRatio { 0.5f };
+
+float Cross(const cv::Point2f& a, const cv::Point2f& b)
+{
+	return a.x * b.y - a.y * b.x;
+}
+
+float Length(const cv::Point2f& vector)
+{
+	return std::sqrt(vector.x * vector.x + vector.y * vector.y);
+}
+
+bool AreSpacingsConsistent(const cv::Point2f& previous_step, const cv::Point2f& next_step)
+{
+	cv::Point2f difference = next_step - previous_step;
+	float mean_length = 0.5f * (Length(previous_step) + Length(next_step));
+	return mean_length > 0.0f && Length(difference) <= kGridSpacingTolerance * mean_length;
+}
+
+} // namespace
+
+
+ChessboardTracker::ChessboardTracker(const CameraCalibrationSettings& calibration_settings)
+{
+	calibration_settings_ = calibration_settings;
+}
+
+bool ChessboardTracker::Process(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners)
+{
+	last_frame_tracked_ = Track(image_gray, corners);
+	last_frame_found_in_region_ = false;
+
+	bool pattern_found = last_frame_tracked_;
+	if (last_frame_tracked_) {
+		++tracked_frame_count_;
+	}
+	else if (DetectInRegion(image_gray, corners)) {
+		pattern_found = true;
+		last_frame_found_in_region_ = true;
+		++region_detected_frame_count_;
+	}
+	else {
+		pattern_found = FindChessboardCorners(image_gray, calibration_settings_, corners);
+		++detected_frame_count_;
+	}
+
+	if (pattern_found) {
+		UpdateBoardRegion(corners);
+		previous_image_gray_ = image_gray;
+		previous_corners_ = corners;
+	}
+	else {
+		previous_image_gray_.release();
+		previous_corners_.clear();
+		if (++missed_frame_count_ > kMaximumMissedFrames) {
+			has_board_region_ = false;
+		}
+	}
+
+	return pattern_found;
+}
+
+void ChessboardTracker::Reset()
+{
+	previous_image_gray_.release();
+	previous_corners_.clear();
+	board_motion_ = 0.0f;
+	has_board_region_ = false;
+	missed_frame_count_ = 0;
+}
+
+bool ChessboardTracker::Track(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners) const
+{
+	if (previous_corners_.empty() || previous_image_gray_.size() != image_gray.size()) {
+		return false;
+	}
+
+	std::vector<uchar> status;
+	std::vector<float> errors;
+	cv::calcOpticalFlowPyrLK(
+		previous_image_gray_,
+		image_gray,
+		previous_corners_,
+		corners,
+		status,
+		errors,
+		kOpticalFlowWindowSize,
+		kOpticalFlowPyramidLevels,
+		kOpticalFlowCriteria);
+
+	const float maximum_x = static_cast<float>(image_gray.cols - 1);
+	const float maximum_y = static_cast<float>(image_gray.rows - 1);
+	for (size_t i { 0 }; i < corners.size(); ++i) {
+		if (!status[i] ||
+			corners[i].x < 0.0f || corners[i].y < 0.0f || corners[i].x > maximum_x || corners[i].y > maximum_y)
+		{
+			return false;
+		}
+	}
+
+	const cv::Size board_size = calibration_settings_.GetCalibrationBoardSize();
+	if (!IsChessboardGridConsistent(corners, board_size)) {
+		return false;
+	}
+
+	std::vector<cv::Point2f> flow_corners = corners;
+	cv::cornerSubPix(image_gray, corners, kSnapWindowSize, cv::Size(-1, -1), kSnapCriteria);
+
+	// A corner that had to move far to reach a saddle point was tracked onto the wrong
+	// spot (blur, occlusion); the grid check alone does not see small shifts like this.
+	float maximum_snap_displacement = kSnapDisplacementTolerance * GetMinimumCornerSpacing(flow_corners, board_size);
+	for (size_t i { 0 }; i < corners.size(); ++i) {
+		if (Length(corners[i] - flow_corners[i]) > maximum_snap_displacement) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ChessboardTracker::DetectInRegion(const cv::Mat& image_gray, std::vector<cv::Point2f>& corners) const
+{
+	cv::Rect region;
+	if (!GetSearchRegion(image_gray.size(), region)) {
+		return false;
+	}
+
+	if (!FindChessboardCorners(image_gray(region), calibration_settings_, corners)) {
+		return false;
+	}
+
+	const cv::Point2f offset(static_cast<float>(region.x), static_cast<float>(region.y));
+	for (cv::Point2f& corner : corners) {
+		corner += offset;
+	}
+	return true;
+}
+
+bool ChessboardTracker::GetSearchRegion(const cv::Size& image_size, cv::Rect& region) const
+{
+	if (!has_board_region_) {
+		return false;
+	}
+
+	// Rough square size from the bounding box; too large for a rotated board, which
+	// only makes the padding safer.
+	const cv::Size board_size = calibration_settings_.GetCalibrationBoardSize();
+	const cv::Point2f extent = board_maximum_ - board_minimum_;
+	const float square_size = std::max(extent.x, extent.y) /
+		static_cast<float>(std::max(std::max(board_size.width, board_size.height) - 1, 1));
+	const float padding = kRegionPaddingSquares * square_size +
+		kRegionMotionFactor * board_motion_ * static_cast<float>(missed_frame_count_ + 1);
+
+	const int left = std::max(0, static_cast<int>(std::floor(board_minimum_.x - padding)));
+	const int top = std::max(0, static_cast<int>(std::floor(board_minimum_.y - padding)));
+	const int right = std::min(image_size.width, static_cast<int>(std::ceil(board_maximum_.x + padding)) + 1);
+	const int bottom = std::min(image_size.height, static_cast<int>(std::ceil(board_maximum_.y + padding)) + 1);
+	if (right <= left || bottom <= top) {
+		return false;
+	}
+
+	region = cv::Rect(left, top, right - left, bottom - top);
+	return static_cast<float>(region.width) * static_cast<float>(region.height) <=
+		kMaximumRegionAreaRatio * static_cast<float>(image_size.width) * static_cast<float>(image_size.height);
+}
+
+void ChessboardTracker::UpdateBoardRegion(const std::vector<cv::Point2f>& corners)
+{
+	cv::Point2f minimum = corners.front();
+	cv::Point2f maximum = corners.front();
+	for (const cv::Point2f& corner : corners) {
+		minimum.x = std::min(minimum.x, corner.x);
+		minimum.y = std::min(minimum.y, corner.y);
+		maximum.x = std::max(maximum.x, corner.x);
+		maximum.y = std::max(maximum.y, corner.y);
+	}
+
+	// The box center does not depend on corner order, which findChessboardCorners may
+	// flip between frames for symmetric boards.
+	if (has_board_region_) {
+		const cv::Point2f center_shift = 0.5f * (minimum + maximum) - 0.5f * (board_minimum_ + board_maximum_);
+		board_motion_ = Length(center_shift) / static_cast<float>(missed_frame_count_ + 1);
+	}
+	else {
+		board_motion_ = 0.0f;
+	}
+
+	board_minimum_ = minimum;
+	board_maximum_ = maximum;
+	has_board_region_ = true;
+	missed_frame_count_ = 0;
+}
+
+
+bool IsChessboardGridConsistent(const std::vector<cv::Point2f>& corners, const cv::Size& board_size)
+{
+	if (board_size.width < 2 || board_size.height < 2 ||
+		corners.size() != static_cast<size_t>(board_size.area()))
+	{
+		return false;
+	}
+
+	auto corner = [&](int row, int column) -> const cv::Point2f& {
+		return corners[row * board_size.width + column];
+	};
+
+	const float orientation = Cross(corner(0, 1) - corner(0, 0), corner(1, 0) - corner(0, 0));
+	if (orientation == 0.0f) {
+		return false;
+	}
+
+	for (int row { 0 }; row < board_size.height; ++row) {
+		for (int column { 0 }; column < board_size.width; ++column) {
+			if (row + 1 < board_size.height && column + 1 < board_size.width) {
+				float cell_orientation = Cross(
+					corner(row, column + 1) - corner(row, column),
+					corner(row + 1, column) - corner(row, column));
+				if (cell_orientation * orientation <= 0.0f) {
+					return false;
+				}
+			}
+			if (column + 2 < board_size.width && !AreSpacingsConsistent(
+				corner(row, column + 1) - corner(row, column),
+				corner(row, column + 2) - corner(row, column + 1)))
+			{
+				return false;
+			}
+			if (row + 2 < board_size.height && !AreSpacingsConsistent(
+				corner(row + 1, column) - corner(row, column),
+				corner(row + 2, column) - corner(row + 1, column)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,162 @@
+#include <vector>
+
+#include "camera_calibration/corner_dataset.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+template <typename T>
+void WriteArray(std::ostream& out, const std::vector<T>& values)
+{
+	out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+void ReadArray(std::istream& in, std::vector<T>& values, size_t count)
+{
+	values.resize(count);
+	in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+} // namespace
+
+
+void CornerDataset::SetCorner(size_t index, const cv::Point2f& corner)
+{
+	x_[index] = corner.x;
+	y_[index] = corner.y;
+}
+
+void CornerDataset::SetWeight(size_t index, float weight)
+{
+	weights_[index] = weight;
+}
+
+void CornerDataset::SetValid(size_t index, bool valid)
+{
+	valid_[index] = valid;
+}
+
+std::vector<cv::Point2f> CornerDataset::GetViewCorners(size_t view) const
+{
+	std::vector<cv::Point2f> corners;
+	corners.reserve(GetViewCornerCount(view));
+	for (size_t i = GetViewBegin(view); i < GetViewEnd(view); ++i) {
+		if (valid_[i]) {
+			corners.push_back(cv::Point2f(x_[i], y_[i]));
+		}
+	}
+	return corners;
+}
+
+size_t CornerDataset::AddView(
+	const cv::Point2f* corners,
+	size_t corner_count,
+	const int32_t* board_indices,
+	const float* weights)
+{
+	for (size_t i { 0 }; i < corner_count; ++i) {
+		x_.push_back(corners[i].x);
+		y_.push_back(corners[i].y);
+		weights_.push_back(weights != nullptr ? weights[i] : 1.0f);
+		board_indices_.push_back(board_indices != nullptr ? board_indices[i] : static_cast<int32_t>(i));
+	}
+	valid_.resize(x_.size(), true);
+	view_offsets_.push_back(x_.size());
+	return GetViewCount() - 1;
+}
+
+size_t CornerDataset::AddView(const std::vector<cv::Point2f>& corners)
+{
+	return AddView(corners.data(), corners.size());
+}
+
+size_t CornerDataset::AddView(const CornerDataset& dataset, size_t view)
+{
+	size_t begin = dataset.GetViewBegin(view);
+	size_t end = dataset.GetViewEnd(view);
+	x_.insert(x_.end(), dataset.x_.begin() + begin, dataset.x_.begin() + end);
+	y_.insert(y_.end(), dataset.y_.begin() + begin, dataset.y_.begin() + end);
+	weights_.insert(weights_.end(), dataset.weights_.begin() + begin, dataset.weights_.begin() + end);
+	board_indices_.insert(board_indices_.end(), dataset.board_indices_.begin() + begin, dataset.board_indices_.begin() + end);
+	valid_.insert(valid_.end(), dataset.valid_.begin() + begin, dataset.valid_.begin() + end);
+	view_offsets_.push_back(x_.size());
+	return GetViewCount() - 1;
+}
+
+void CornerDataset::Reserve(size_t view_count, size_t corner_count)
+{
+	view_offsets_.reserve(view_count + 1);
+	x_.reserve(corner_count);
+	y_.reserve(corner_count);
+	weights_.reserve(corner_count);
+	board_indices_.reserve(corner_count);
+	valid_.reserve(corner_count);
+}
+
+void CornerDataset::Clear()
+{
+	view_offsets_.assign(1, 0);
+	x_.clear();
+	y_.clear();
+	weights_.clear();
+	board_indices_.clear();
+	valid_.clear();
+}
+
+bool CornerDataset::WriteTo(std::ostream& out) const
+{
+	uint64_t counts[2] { GetViewCount(), GetCornerCount() };
+	out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+	WriteArray(out, view_offsets_);
+	WriteArray(out, x_);
+	WriteArray(out, y_);
+	WriteArray(out, weights_);
+	WriteArray(out, board_indices_);
+	WriteArray(out, valid_);
+	return static_cast<bool>(out);
+}
+
+bool CornerDataset::ReadFrom(std::istream& in)
+{
+	uint64_t counts[2] { 0, 0 };
+	if (!in.read(reinterpret_cast<char*>(counts), sizeof(counts))) {
+		return false;
+	}
+
+	// Sizes come from the stream, check that it actually holds that much data
+	// before allocating for it.
+	std::streampos position = in.tellg();
+	in.seekg(0, std::ios::end);
+	uint64_t remaining_size = static_cast<uint64_t>(in.tellg() - position);
+	in.seekg(position);
+	uint64_t corner_size = 3 * sizeof(float) + sizeof(int32_t) + sizeof(uint8_t);
+	if (counts[0] >= remaining_size / sizeof(uint64_t) ||
+		counts[1] > (remaining_size - (counts[0] + 1) * sizeof(uint64_t)) / corner_size)
+	{
+		return false;
+	}
+
+	ReadArray(in, view_offsets_, static_cast<size_t>(counts[0] + 1));
+	ReadArray(in, x_, static_cast<size_t>(counts[1]));
+	ReadArray(in, y_, static_cast<size_t>(counts[1]));
+	ReadArray(in, weights_, static_cast<size_t>(counts[1]));
+	ReadArray(in, board_indices_, static_cast<size_t>(counts[1]));
+	ReadArray(in, valid_, static_cast<size_t>(counts[1]));
+
+	bool offsets_valid = static_cast<bool>(in) && view_offsets_.front() == 0 && view_offsets_.back() == counts[1];
+	for (size_t view { 0 }; offsets_valid && view < counts[0]; ++view) {
+		offsets_valid = view_offsets_[view] <= view_offsets_[view + 1];
+	}
+	if (!offsets_valid) {
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iterator>
+
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/corner_refinement.h"
+#include "camera_calibration/parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CAMERA_CALIBRATION_HAS_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CAMERA_CALIBRATION_HAS_AVX2
+#endif
+
+namespace camera_calibration {
+
+
+namespace {
+
+// cornerSubPix never runs more iterations than this.
+const int kMaxIterationCount { 100 };
+
+const int kSpecializedWindows[] { 15, 11, 7, 5 };
+
+// Geometry of a (2 * kHalfWindow + 1)^2 window. Rows are padded with zero weights to
+// a multiple of 8 so the SIMD loops have no tail; the sampled patch has one extra
+// pixel on every side for the central-difference gradients.
+template <int kHalfWindow>
+struct Window
+{
+	static const int kWidth = 2 * kHalfWindow + 1;
+	static const int kPaddedWidth = (kWidth + 7) / 8 * 8;
+	static const int kPatchStride = kPaddedWidth + 2;
+	static const int kPatchRows = kWidth + 2;
+
+	alignas(32) float weights[kWidth * kPaddedWidth];
+	alignas(32) float offsets[kPaddedWidth];
+};
+
+// Same Gaussian weights and zero zone as cornerSubPix.
+template <int kHalfWindow>
+void InitializeWindow(Window<kHalfWindow>& window, const cv::Size& zero_zone_size)
+{
+	using WindowType = Window<kHalfWindow>;
+	std::fill(window.weights, window.weights + WindowType::kWidth * WindowType::kPaddedWidth, 0.0f);
+	std::fill(window.offsets, window.offsets + WindowType::kPaddedWidth, 0.0f);
+
+	for (int i { 0 }; i < WindowType::kWidth; ++i) {
+		float y = static_cast<float>(i - kHalfWindow) / kHalfWindow;
+		float vy = std::exp(-y * y);
+		for (int j { 0 }; j < WindowType::kWidth; ++j) {
+			float x = static_cast<float>(j - kHalfWindow) / kHalfWindow;
+			window.weights[i * WindowType::kPaddedWidth + j] = vy * std::exp(-x * x);
+		}
+	}
+	for (int j { 0 }; j < WindowType::kWidth; ++j) {
+		window.offsets[j] = static_cast<float>(j - kHalfWindow);
+	}
+
+	if (zero_zone_size.width >= 0 && zero_zone_size.height >= 0 &&
+		zero_zone_size.width * 2 + 1 < WindowType::kWidth && zero_zone_size.height * 2 + 1 < WindowType::kWidth)
+	{
+		for (int i = kHalfWindow - zero_zone_size.height; i <= kHalfWindow + zero_zone_size.height; ++i) {
+			for (int j = kHalfWindow - zero_zone_size.width; j <= kHalfWindow + zero_zone_size.width; ++j) {
+				window.weights[i * WindowType::kPaddedWidth + j] = 0.0f;
+			}
+		}
+	}
+}
+
+// Bilinear patch centred on center like cv::getRectSubPix, with replicated borders.
+// Padding columns are zeroed.
+template <int kHalfWindow>
+void SamplePatch(const cv::Mat& image_gray, const cv::Point2f& center, float* patch)
+{
+	using WindowType = Window<kHalfWindow>;
+	const int kPatchWidth = WindowType::kWidth + 2;
+
+	const float origin_x = center.x - (kHalfWindow + 1);
+	const float origin_y = center.y - (kHalfWindow + 1);
+	const int ix = static_cast<int>(std::floor(origin_x));
+	const int iy = static_cast<int>(std::floor(origin_y));
+	const float ax = origin_x - ix;
+	const float ay = origin_y - iy;
+	const float w00 = (1.0f - ax) * (1.0f - ay);
+	const float w01 = ax * (1.0f - ay);
+	const float w10 = (1.0f - ax) * ay;
+	const float w11 = ax * ay;
+
+	const int last_column = image_gray.cols - 1;
+	const int last_row = image_gray.rows - 1;
+	const bool inside = ix >= 0 && iy >= 0 && ix + kPatchWidth < image_gray.cols && iy + kPatchWidth < image_gray.rows;
+
+	for (int r { 0 }; r < WindowType::kPatchRows; ++r) {
+		const uchar* row0 = image_gray.ptr<uchar>(std::min(std::max(iy + r, 0), last_row));
+		const uchar* row1 = image_gray.ptr<uchar>(std::min(std::max(iy + r + 1, 0), last_row));
+		float* patch_row = patch + r * WindowType::kPatchStride;
+		if (inside) {
+			const uchar* s0 = row0 + ix;
+			const uchar* s1 = row1 + ix;
+			for (int c { 0 }; c < kPatchWidth; ++c) {
+				patch_row[c] = w00 * s0[c] + w01 * s0[c + 1] + w10 * s1[c] + w11 * s1[c + 1];
+			}
+		}
+		else {
+			for (int c { 0 }; c < kPatchWidth; ++c) {
+				const int x0 = std::min(std::max(ix + c, 0), last_column);
+				const int x1 = std::min(std::max(ix + c + 1, 0), last_column);
+				patch_row[c] = w00 * row0[x0] + w01 * row0[x1] + w10 * row1[x0] + w11 * row1[x1];
+			}
+		}
+		std::fill(patch_row + kPatchWidth, patch_row + WindowType::kPatchStride, 0.0f);
+	}
+}
+
+// Sums of the cornerSubPix normal equations: a = sum(gx gx w), b = sum(gx gy w),
+// c = sum(gy gy w), bb1 = sum((gx gx px + gx gy py) w), bb2 = sum((gx gy px + gy gy py) w).
+// Per row py is constant, so only a, b, c and the px-weighted a and b are vector sums.
+struct GradientSums
+{
+	double a, b, c, bb1, bb2;
+};
+
+void AddRowSums(GradientSums& sums, float a, float b, float c, float a_px, float b_px, float py)
+{
+	sums.a += a;
+	sums.b += b;
+	sums.c += c;
+	sums.bb1 += static_cast<double>(a_px) + static_cast<double>(py) * b;
+	sums.bb2 += static_cast<double>(b_px) + static_cast<double>(py) * c;
+}
+
+template <int kHalfWindow>
+GradientSums AccumulateGradientsScalar(const float* patch, const Window<kHalfWindow>& window)
+{
+	using WindowType = Window<kHalfWindow>;
+	GradientSums sums { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (int i { 0 }; i < WindowType::kWidth; ++i) {
+		const float* row = patch + (i + 1) * WindowType::kPatchStride + 1;
+		const float* weights = window.weights + i * WindowType::kPaddedWidth;
+		float a { 0.0f }, b { 0.0f }, c { 0.0f }, a_px { 0.0f }, b_px { 0.0f };
+		for (int j { 0 }; j < WindowType::kWidth; ++j) {
+			float gx = row[j + 1] - row[j - 1];
+			float gy = row[j + WindowType::kPatchStride] - row[j - WindowType::kPatchStride];
+			float gxx = gx * gx * weights[j];
+			float gxy = gx * gy * weights[j];
+			a += gxx;
+			b += gxy;
+			c += gy * gy * weights[j];
+			a_px += gxx * window.offsets[j];
+			b_px += gxy * window.offsets[j];
+		}
+		AddRowSums(sums, a, b, c, a_px, b_px, static_cast<float>(i - kHalfWindow));
+	}
+	return sums;
+}
+
+#ifdef CAMERA_CALIBRATION_HAS_SSE2
+
+float HorizontalSum(__m128 v)
+{
+	__m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+template <int kHalfWindow>
+GradientSums AccumulateGradientsSse2(const float* patch, const Window<kHalfWindow>& window)
+{
+	using WindowType = Window<kHalfWindow>;
+	GradientSums sums { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (int i { 0 }; i < WindowType::kWidth; ++i) {
+		const float* row = patch + (i + 1) * WindowType::kPatchStride + 1;
+		const float* weights = window.weights + i * WindowType::kPaddedWidth;
+		__m128 a = _mm_setzero_ps(), b = _mm_setzero_ps(), c = _mm_setzero_ps();
+		__m128 a_px = _mm_setzero_ps(), b_px = _mm_setzero_ps();
+		for (int j { 0 }; j < WindowType::kPaddedWidth; j += 4) {
+			__m128 gx = _mm_sub_ps(_mm_loadu_ps(row + j + 1), _mm_loadu_ps(row + j - 1));
+			__m128 gy = _mm_sub_ps(
+				_mm_loadu_ps(row + j + WindowType::kPatchStride), 
+				_mm_loadu_ps(row + j - WindowType::kPatchStride));
+			__m128 weight = _mm_load_ps(weights + j);
+			__m128 offset = _mm_load_ps(window.offsets + j);
+			__m128 gxx = _mm_mul_ps(_mm_mul_ps(gx, gx), weight);
+			__m128 gxy = _mm_mul_ps(_mm_mul_ps(gx, gy), weight);
+			a = _mm_add_ps(a, gxx);
+			b = _mm_add_ps(b, gxy);
+			c = _mm_add_ps(c, _mm_mul_ps(_mm_mul_ps(gy, gy), weight));
+			a_px = _mm_add_ps(a_px, _mm_mul_ps(gxx, offset));
+			b_px = _mm_add_ps(b_px, _mm_mul_ps(gxy, offset));
+		}
+		AddRowSums(
+			sums, 
+			HorizontalSum(a), HorizontalSum(b), HorizontalSum(c), HorizontalSum(a_px), HorizontalSum(b_px), 
+			static_cast<float>(i - kHalfWindow));
+	}
+	return sums;
+}
+
+#endif
+
+#ifdef CAMERA_CALIBRATION_HAS_AVX2
+
+__attribute__((target("avx2,fma")))
+float HorizontalSumAvx2(__m256 v)
+{
+	__m128 quad = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	__m128 pairs = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+template <int kHalfWindow>
+__attribute__((target("avx2,fma")))
+GradientSums AccumulateGradientsAvx2(const float* patch, const Window<kHalfWindow>& window)
+{
+	using WindowType = Window<kHalfWindow>;
+	GradientSums sums { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (int i { 0 }; i < WindowType::kWidth; ++i) {
+		const float* row = patch + (i + 1) * WindowType::kPatchStride + 1;
+		const float* weights = window.weights + i * WindowType::kPaddedWidth;
+		__m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps(), c = _mm256_setzero_ps();
+		__m256 a_px = _mm256_setzero_ps(), b_px = _mm256_setzero_ps();
+		for (int j { 0 }; j < WindowType::kPaddedWidth; j += 8) {
+			__m256 gx = _mm256_sub_ps(_mm256_loadu_ps(row + j + 1), _mm256_loadu_ps(row + j - 1));
+			__m256 gy = _mm256_sub_ps(
+				_mm256_loadu_ps(row + j + WindowType::kPatchStride), 
+				_mm256_loadu_ps(row + j - WindowType::kPatchStride));
+			__m256 weight = _mm256_load_ps(weights + j);
+			__m256 offset = _mm256_load_ps(window.offsets + j);
+			__m256 gx_weighted = _mm256_mul_ps(gx, weight);
+			__m256 gxx = _mm256_mul_ps(gx_weighted, gx);
+			__m256 gxy = _mm256_mul_ps(gx_weighted, gy);
+			a = _mm256_add_ps(a, gxx);
+			b = _mm256_add_ps(b, gxy);
+			c = _mm256_fmadd_ps(_mm256_mul_ps(gy, weight), gy, c);
+			a_px = _mm256_fmadd_ps(gxx, offset, a_px);
+			b_px = _mm256_fmadd_ps(gxy, offset, b_px);
+		}
+		AddRowSums(
+			sums, 
+			HorizontalSumAvx2(a), HorizontalSumAvx2(b), HorizontalSumAvx2(c), 
+			HorizontalSumAvx2(a_px), HorizontalSumAvx2(b_px), 
+			static_cast<float>(i - kHalfWindow));
+	}
+	return sums;
+}
+
+#endif
+
+enum class KernelIsa
+{
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+KernelIsa ChooseKernelIsa()
+{
+#ifdef CAMERA_CALIBRATION_HAS_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return KernelIsa::AVX2;
+	}
+#endif
+#ifdef CAMERA_CALIBRATION_HAS_SSE2
+	return KernelIsa::SSE2;
+#else
+	return KernelIsa::SCALAR;
+#endif
+}
+
+KernelIsa GetKernelIsa()
+{
+	static const KernelIsa kernel_isa = ChooseKernelIsa();
+	return kernel_isa;
+}
+
+// The cornerSubPix iteration for one window size and gradient kernel.
+template <int kHalfWindow, GradientSums (*AccumulateGradients)(const float*, const Window<kHalfWindow>&)>
+void RefineCornersFixedWindow(
+	const cv::Mat& image_gray,
+	cv::Point2f* corners,
+	size_t corner_count,
+	const cv::Size& zero_zone_size,
+	const cv::TermCriteria& criteria,
+	int thread_count)
+{
+	using WindowType = Window<kHalfWindow>;
+	WindowType window;
+	InitializeWindow(window, zero_zone_size);
+
+	const int max_iteration_count = (criteria.type & cv::TermCriteria::COUNT) ? 
+		std::min(std::max(criteria.maxCount, 1), kMaxIterationCount) : kMaxIterationCount;
+	double epsilon = (criteria.type & cv::TermCriteria::EPS) ? std::max(criteria.epsilon, 0.0) : 0.0;
+	epsilon *= epsilon;
+
+	ParallelFor(corner_count, thread_count, [&](size_t index) {
+		alignas(32) float patch[WindowType::kPatchRows * WindowType::kPatchStride];
+		const cv::Point2f initial = corners[index];
+		cv::Point2f current = initial;
+		int iteration { 0 };
+		double error { 0.0 };
+
+		do {
+			SamplePatch<kHalfWindow>(image_gray, current, patch);
+			GradientSums sums = AccumulateGradients(patch, window);
+
+			double determinant = sums.a * sums.c - sums.b * sums.b;
+			if (std::fabs(determinant) <= DBL_EPSILON * DBL_EPSILON) {
+				break;
+			}
+
+			double scale = 1.0 / determinant;
+			cv::Point2f next(
+				static_cast<float>(current.x + sums.c * scale * sums.bb1 - sums.b * scale * sums.bb2),
+				static_cast<float>(current.y - sums.b * scale * sums.bb1 + sums.a * scale * sums.bb2));
+			error = (next.x - current.x) * (next.x - current.x) + (next.y - current.y) * (next.y - current.y);
+			current = next;
+			if (current.x < 0 || current.x >= image_gray.cols || current.y < 0 || current.y >= image_gray.rows) {
+				break;
+			}
+		} while (++iteration < max_iteration_count && error > epsilon);
+
+		// A corner that moved out of its window did not converge; keep the initial one.
+		if (std::fabs(current.x - initial.x) > kHalfWindow || std::fabs(current.y - initial.y) > kHalfWindow) {
+			current = initial;
+		}
+		corners[index] = current;
+	});
+}
+
+template <int kHalfWindow>
+void RefineCornersWindow(
+	const cv::Mat& image_gray,
+	cv::Point2f* corners,
+	size_t corner_count,
+	const cv::Size& zero_zone_size,
+	const cv::TermCriteria& criteria,
+	int thread_count)
+{
+	switch (GetKernelIsa()) {
+#ifdef CAMERA_CALIBRATION_HAS_AVX2
+	case KernelIsa::AVX2:
+		RefineCornersFixedWindow<kHalfWindow, AccumulateGradientsAvx2<kHalfWindow>>(
+			image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+#endif
+#ifdef CAMERA_CALIBRATION_HAS_SSE2
+	case KernelIsa::SSE2:
+		RefineCornersFixedWindow<kHalfWindow, AccumulateGradientsSse2<kHalfWindow>>(
+			image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+#endif
+	default:
+		RefineCornersFixedWindow<kHalfWindow, AccumulateGradientsScalar<kHalfWindow>>(
+			image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+	}
+}
+
+} // namespace
+
+
+void RefineCornersSubPix(
+	const cv::Mat& image_gray,
+	cv::Point2f* corners,
+	size_t corner_count,
+	const cv::Size& window_size,
+	const cv::Size& zero_zone_size,
+	const cv::TermCriteria& criteria,
+	int thread_count)
+{
+	if (corner_count == 0) {
+		return;
+	}
+
+	// Images too small for the window keep cornerSubPix's own checks and errors.
+	const bool specialized = image_gray.type() == CV_8UC1 && window_size.width == window_size.height &&
+		std::find(std::begin(kSpecializedWindows), std::end(kSpecializedWindows), window_size.width) != 
+			std::end(kSpecializedWindows) &&
+		image_gray.cols >= window_size.width * 2 + 5 && image_gray.rows >= window_size.height * 2 + 5;
+	if (!specialized) {
+		cv::Mat corners_view(static_cast<int>(corner_count), 1, CV_32FC2, corners);
+		cv::cornerSubPix(image_gray, corners_view, window_size, zero_zone_size, criteria);
+		return;
+	}
+
+	switch (window_size.width) {
+	case 5:
+		RefineCornersWindow<5>(image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+	case 7:
+		RefineCornersWindow<7>(image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+	case 11:
+		RefineCornersWindow<11>(image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+	case 15:
+		RefineCornersWindow<15>(image_gray, corners, corner_count, zero_zone_size, criteria, thread_count);
+		break;
+	}
+}
+
+int GetSpecializedRefinementWindow(float half_window, int max_half_window)
+{
+	int nearest_window { 0 };
+	for (int specialized_window : kSpecializedWindows) {
+		if (specialized_window <= max_half_window && 
+			(nearest_window == 0 || std::abs(specialized_window - half_window) <= std::abs(nearest_window - half_window)))
+		{
+			nearest_window = specialized_window;
+		}
+	}
+	const int smallest_window = kSpecializedWindows[sizeof(kSpecializedWindows) / sizeof(kSpecializedWindows[0]) - 1];
+	if (nearest_window == 0 || half_window < smallest_window - 0.5f) {
+		return std::min(max_half_window, static_cast<int>(std::lround(half_window)));
+	}
+	return nearest_window;
+}
+
+const char* GetCornerRefinementKernelName()
+{
+	switch (GetKernelIsa()) {
+	case KernelIsa::AVX2:
+		return "avx2";
+	case KernelIsa::SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+
+} // namespace camera_calibration
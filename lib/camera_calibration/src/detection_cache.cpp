@@ -0,0 +1,249 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "camera_calibration/chessboard_detection.h"
+#include "camera_calibration/detection_cache.h"
+#include "camera_calibration/hash.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+const char kDetectionCacheMagic[8] { 'D', 'E', 'T', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t kDetectionCacheVersion { 6 };
+const std::string kDetectionCacheFileName { ".camera_calibration_cache.bin" };
+const std::string kDetectionCacheFilePrefix { ".camera_calibration_cache_" };
+const std::string kDetectionCacheFileExtension { ".bin" };
+
+// Cache file layout (native little-endian): magic, version, entry count, one record
+// per entry, then the corner dataset (see CornerDataset::WriteTo).
+struct DetectionCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t entry_count;
+};
+
+struct DetectionCacheRecord
+{
+	uint64_t key;
+	uint64_t image_hash;
+	int32_t image_width;
+	int32_t image_height;
+	uint16_t pattern_found;
+	uint16_t detection_stage;
+	uint32_t view;
+};
+
+static_assert(sizeof(DetectionCacheHeader) == 24, "unexpected detection cache header layout");
+static_assert(sizeof(DetectionCacheRecord) == 32, "unexpected detection cache record layout");
+
+} // namespace
+
+
+DetectionCache::DetectionCache(const std::string& cache_file_path, const CameraCalibrationSettings& calibration_settings)
+	: cache_file_path_(cache_file_path)
+{
+	cv::TermCriteria accuracy_criteria = calibration_settings.GetAccuracyCriteria();
+
+	std::ostringstream settings_description;
+	settings_description << std::setprecision(17)
+		<< calibration_settings.GetCalibrationGridPattern() << ';'
+		<< calibration_settings.GetCalibrationBoardSize().width << 'x' << calibration_settings.GetCalibrationBoardSize().height << ';'
+		<< calibration_settings.GetDecodeScale() << ';'
+		<< calibration_settings.GetExpectedSquareSize() << ';'
+		<< calibration_settings.GetSearchWindowSize().width << 'x' << calibration_settings.GetSearchWindowSize().height << ';'
+		<< calibration_settings.GetMaxSearchWindowSize() << ';'
+		<< calibration_settings.GetZeroZoneSize().width << 'x' << calibration_settings.GetZeroZoneSize().height << ';'
+		<< calibration_settings.GetUseSubPixKernels() << ',' << calibration_settings.GetScaleSubPixCriteria() << ';'
+		<< accuracy_criteria.type << ',' << accuracy_criteria.maxCount << ',' << accuracy_criteria.epsilon << ';'
+		<< calibration_settings.GetUseQualityFilter() << ',' << calibration_settings.GetMinSharpness() << ',' 
+		<< calibration_settings.GetMaxClippedFraction();
+
+	for (DetectionStage stage : calibration_settings.GetDetectionCascade()) {
+		settings_description << ';' << GetDetectionStageName(stage);
+	}
+
+	std::string description = settings_description.str();
+	settings_hash_ = HashBytes(description.data(), description.size());
+}
+
+bool DetectionCache::LoadFromFile()
+{
+	std::ifstream fin(cache_file_path_, std::ios::binary);
+	if (!fin.is_open()) {
+		return false;
+	}
+
+	DetectionCacheHeader header;
+	if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		std::memcmp(header.magic, kDetectionCacheMagic, sizeof(header.magic)) != 0 ||
+		header.version != kDetectionCacheVersion)
+	{
+		return false;
+	}
+
+	std::streampos records_position = fin.tellg();
+	fin.seekg(0, std::ios::end);
+	uint64_t remaining_size = static_cast<uint64_t>(fin.tellg() - records_position);
+	fin.seekg(records_position);
+	if (header.entry_count > remaining_size / sizeof(DetectionCacheRecord)) {
+		return false;
+	}
+
+	std::vector<DetectionCacheRecord> records(static_cast<size_t>(header.entry_count));
+	CornerDataset corners;
+	if (!fin.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(DetectionCacheRecord)) ||
+		!corners.ReadFrom(fin))
+	{
+		return false;
+	}
+
+	std::unordered_map<uint64_t, StoredEntry> entries;
+	for (const auto& record : records) {
+		if (record.pattern_found && 
+			(record.view >= corners.GetViewCount() || 
+			record.detection_stage > static_cast<uint16_t>(DetectionStage::EQUALIZED)))
+		{
+			return false;
+		}
+		entries[record.key] = StoredEntry { 
+			record.pattern_found != 0, 
+			cv::Size(record.image_width, record.image_height), 
+			record.view,
+			static_cast<DetectionStage>(record.detection_stage),
+			record.image_hash,
+			false };
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_ = std::move(entries);
+	corners_ = std::move(corners);
+	return true;
+}
+
+bool DetectionCache::SaveToFile() const
+{
+	DetectionCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, kDetectionCacheMagic, sizeof(header.magic));
+	header.version = kDetectionCacheVersion;
+
+	std::ofstream fout(cache_file_path_, std::ios::binary);
+	if (!fout.is_open()) {
+		return false;
+	}
+
+	// Unused entries are dropped and the corners of the kept ones are copied into a
+	// compact dataset, which also sheds views of entries replaced by Insert.
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<DetectionCacheRecord> records;
+	CornerDataset corners;
+	records.reserve(entries_.size());
+	for (const auto& item : entries_) {
+		const StoredEntry& entry = item.second;
+		if (!entry.used) {
+			continue;
+		}
+		size_t view = entry.pattern_found ? corners.AddView(corners_, entry.view) : 0;
+		records.push_back(DetectionCacheRecord { 
+			item.first, 
+			entry.image_hash, 
+			entry.image_size.width, 
+			entry.image_size.height, 
+			entry.pattern_found, 
+			static_cast<uint16_t>(entry.detection_stage), 
+			static_cast<uint32_t>(view) });
+	}
+	header.entry_count = records.size();
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(DetectionCacheRecord));
+	corners.WriteTo(fout);
+	fout.close();
+	return static_cast<bool>(fout);
+}
+
+uint64_t DetectionCache::GetKey(const std::vector<uchar>& image_file_content) const
+{
+	return HashBytes(image_file_content.data(), image_file_content.size(), settings_hash_);
+}
+
+bool DetectionCache::Find(uint64_t key, Entry& entry) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto entry_iterator = entries_.find(key);
+	if (entry_iterator == entries_.end()) {
+		++miss_count_;
+		return false;
+	}
+
+	const StoredEntry& stored_entry = entry_iterator->second;
+	stored_entry.used = true;
+	entry.pattern_found = stored_entry.pattern_found;
+	entry.image_size = stored_entry.image_size;
+	entry.detection_stage = stored_entry.detection_stage;
+	entry.image_hash = stored_entry.image_hash;
+	entry.corners.clear();
+	if (stored_entry.pattern_found) {
+		entry.corners = corners_.GetViewCorners(stored_entry.view);
+	}
+	++hit_count_;
+	return true;
+}
+
+void DetectionCache::Insert(uint64_t key, const Entry& entry)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	size_t view = entry.pattern_found ? corners_.AddView(entry.corners) : 0;
+	entries_[key] = StoredEntry { entry.pattern_found, entry.image_size, view, entry.detection_stage, entry.image_hash, true };
+}
+
+size_t DetectionCache::GetHitCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hit_count_;
+}
+
+size_t DetectionCache::GetMissCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return miss_count_;
+}
+
+std::string DetectionCache::GetDefaultFilePath(const std::string& image_source_path)
+{
+	std::string directory = image_source_path;
+	std::string file_name = kDetectionCacheFileName;
+
+	size_t wildcard_position = image_source_path.find_first_of("*?[");
+	if (wildcard_position != std::string::npos) {
+		size_t separator_position = image_source_path.find_last_of("/\\", wildcard_position);
+		directory = separator_position == std::string::npos ? "." : image_source_path.substr(0, separator_position);
+
+		// Saving prunes entries not used in the run, so patterns sharing a directory
+		// get files of their own instead of deleting each other's entries.
+		std::string pattern = separator_position == std::string::npos ? 
+			image_source_path : image_source_path.substr(separator_position + 1);
+		std::ostringstream pattern_file_name;
+		pattern_file_name << kDetectionCacheFilePrefix << std::hex << std::setw(16) << std::setfill('0') 
+			<< HashBytes(pattern.data(), pattern.size()) << kDetectionCacheFileExtension;
+		file_name = pattern_file_name.str();
+	}
+
+	if (directory.empty()) {
+		directory = ".";
+	}
+	if (directory.back() != '/' && directory.back() != '\\') {
+		directory += '/';
+	}
+
+	return directory + file_name;
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/image_ingest.h"
+#include "camera_calibration/detection_cache.h"
+#include "camera_calibration/bounded_queue.h"
+#include "camera_calibration/parallel.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+struct EncodedImage
+{
+	size_t index;
+	uint64_t cache_key;
+	std::vector<uchar> bytes;
+};
+
+struct DecodedImage
+{
+	size_t index;
+	uint64_t cache_key;
+	cv::Mat image_gray;
+	std::vector<uchar> bytes;
+};
+
+int ReducedGrayscaleDecodeFlag(int decode_scale)
+{
+	switch (decode_scale) {
+	case 2 :
+		return cv::IMREAD_REDUCED_GRAYSCALE_2;
+	case 4 :
+		return cv::IMREAD_REDUCED_GRAYSCALE_4;
+	case 8 :
+		return cv::IMREAD_REDUCED_GRAYSCALE_8;
+	default :
+		return cv::IMREAD_GRAYSCALE;
+	}
+}
+
+// Maps corners found on an image decoded at 1/decode_scale back to full resolution pixel coordinates.
+void ScaleCornersToFullResolution(std::vector<cv::Point2f>& corners, int decode_scale)
+{
+	const float scale = static_cast<float>(decode_scale);
+	const float offset = 0.5f * (scale - 1.0f);
+	for (auto& corner : corners) {
+		corner.x = corner.x * scale + offset;
+		corner.y = corner.y * scale + offset;
+	}
+}
+
+bool ReadFileBytes(const std::string& filename, std::vector<uchar>& bytes)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin.is_open()) {
+		return false;
+	}
+
+	fin.seekg(0, std::ios::end);
+	std::streamoff file_size = fin.tellg();
+	fin.seekg(0, std::ios::beg);
+	if (file_size <= 0) {
+		return false;
+	}
+
+	bytes.resize(static_cast<size_t>(file_size));
+	fin.read(reinterpret_cast<char*>(bytes.data()), file_size);
+	return static_cast<bool>(fin);
+}
+
+} // namespace
+
+
+DirectoryImageIngest::DirectoryImageIngest(const CameraCalibrationSettings& calibration_settings, size_t queue_depth)
+	: queue_depth_(queue_depth > 0 ? queue_depth : 1)
+{
+	calibration_settings_ = calibration_settings;
+}
+
+ChessboardDetections DirectoryImageIngest::Run(
+	const std::vector<cv::String>& image_names, 
+	DetectionCache* detection_cache) const
+{
+	BoundedQueue<EncodedImage> encoded_queue(queue_depth_);
+	BoundedQueue<DecodedImage> decoded_queue(queue_depth_);
+
+	std::vector<std::vector<cv::Point2f>> corners_buffers(image_names.size());
+	std::vector<char> pattern_found(image_names.size(), false);
+	std::vector<DetectionStage> detection_stages(image_names.size(), DetectionStage::ADAPTIVE);
+	std::vector<uint64_t> image_hashes(image_names.size(), 0);
+	std::vector<ImageQualityIssue> quality_issues(image_names.size(), ImageQualityIssue::NONE);
+	const bool use_quality_filter = calibration_settings_.GetUseQualityFilter();
+	cv::Size image_size;
+
+	std::exception_ptr first_exception;
+	std::mutex state_mutex;
+
+	auto update_image_size = [&](const cv::Size& size) {
+		std::lock_guard<std::mutex> lock(state_mutex);
+		if (image_size.empty()) {
+			image_size = size;
+		}
+		else if (image_size != size) {
+			throw CameraCalibrationExeption("calibration images have different sizes");
+		}
+	};
+
+	auto abort_pipeline = [&]() {
+		std::lock_guard<std::mutex> lock(state_mutex);
+		if (!first_exception) {
+			first_exception = std::current_exception();
+		}
+		encoded_queue.Close();
+		decoded_queue.Close();
+	};
+
+	auto read_stage = [&]() {
+		try {
+			for (size_t index { 0 }; index < image_names.size(); ++index) {
+				EncodedImage encoded { index, 0, {} };
+				if (!ReadFileBytes(image_names[index], encoded.bytes)) {
+					continue;
+				}
+
+				if (detection_cache != nullptr) {
+					DetectionCache::Entry cached_entry;
+					encoded.cache_key = detection_cache->GetKey(encoded.bytes);
+					if (detection_cache->Find(encoded.cache_key, cached_entry)) {
+						if (cached_entry.pattern_found) {
+							update_image_size(cached_entry.image_size);
+							corners_buffers[index] = std::move(cached_entry.corners);
+							detection_stages[index] = cached_entry.detection_stage;
+							image_hashes[index] = cached_entry.image_hash;
+							pattern_found[index] = true;
+						}
+						continue;
+					}
+				}
+
+				if (!encoded_queue.Push(std::move(encoded))) {
+					break;
+				}
+			}
+		}
+		catch (...) {
+			abort_pipeline();
+		}
+		encoded_queue.Close();
+	};
+
+	const int decode_scale = calibration_settings_.GetDecodeScale();
+
+	auto decode_stage = [&]() {
+		try {
+			EncodedImage encoded;
+			while (encoded_queue.Pop(encoded)) {
+				DecodedImage decoded { 
+					encoded.index, 
+					encoded.cache_key, 
+					cv::imdecode(encoded.bytes, ReducedGrayscaleDecodeFlag(decode_scale)), 
+					{} };
+				if (decoded.image_gray.empty()) {
+					continue;
+				}
+
+				// The compressed bytes travel with a reduced decode so that only images with a
+				// board pay for the full resolution decode needed by the sub-pixel refinement.
+				if (decode_scale > 1) {
+					decoded.bytes = std::move(encoded.bytes);
+				}
+				encoded.bytes = std::vector<uchar>();
+				if (!decoded_queue.Push(std::move(decoded))) {
+					break;
+				}
+			}
+		}
+		catch (...) {
+			abort_pipeline();
+		}
+	};
+
+	auto detect_stage = [&]() {
+		try {
+			DecodedImage decoded;
+			while (decoded_queue.Pop(decoded)) {
+				// Rejected images are not cached, so their reasons are reported on every run.
+				if (use_quality_filter) {
+					ImageQuality quality = MeasureImageQuality(decoded.image_gray);
+					image_hashes[decoded.index] = quality.hash;
+					quality_issues[decoded.index] = CheckImageQuality(quality, calibration_settings_);
+					if (quality_issues[decoded.index] != ImageQualityIssue::NONE) {
+						continue;
+					}
+				}
+
+				std::vector<cv::Point2f>& corners = corners_buffers[decoded.index];
+				DetectionStage& detection_stage = detection_stages[decoded.index];
+				if (!FindChessboardCorners(decoded.image_gray, calibration_settings_, corners, detection_stage)) {
+					if (detection_cache != nullptr) {
+						detection_cache->Insert(
+							decoded.cache_key, 
+							DetectionCache::Entry { false, cv::Size(), {}, detection_stage, image_hashes[decoded.index] });
+					}
+					continue;
+				}
+
+				if (decode_scale > 1) {
+					decoded.image_gray = cv::imdecode(decoded.bytes, cv::IMREAD_GRAYSCALE);
+					decoded.bytes = std::vector<uchar>();
+					ScaleCornersToFullResolution(corners, decode_scale);
+				}
+
+				update_image_size(decoded.image_gray.size());
+
+				RefineChessboardCorners(decoded.image_gray, calibration_settings_, corners);
+				if (detection_cache != nullptr) {
+					detection_cache->Insert(
+						decoded.cache_key, 
+						DetectionCache::Entry { 
+							true, 
+							decoded.image_gray.size(), 
+							corners, 
+							detection_stage, 
+							image_hashes[decoded.index] });
+				}
+				decoded.image_gray.release();
+				pattern_found[decoded.index] = true;
+			}
+		}
+		catch (...) {
+			abort_pipeline();
+		}
+	};
+
+	int thread_count = ResolveThreadCount(calibration_settings_.GetThreadCount());
+	int decode_thread_count = std::max(1, thread_count / 4);
+	int detect_thread_count = std::max(1, thread_count - decode_thread_count);
+
+	std::thread read_thread(read_stage);
+	std::vector<std::thread> decode_threads;
+	for (int i { 0 }; i < decode_thread_count; ++i) {
+		decode_threads.emplace_back(decode_stage);
+	}
+	std::vector<std::thread> detect_threads;
+	for (int i { 0 }; i < detect_thread_count; ++i) {
+		detect_threads.emplace_back(detect_stage);
+	}
+
+	read_thread.join();
+	for (auto& thread : decode_threads) {
+		thread.join();
+	}
+	decoded_queue.Close();
+	for (auto& thread : detect_threads) {
+		thread.join();
+	}
+
+	if (first_exception) {
+		std::rethrow_exception(first_exception);
+	}
+
+	ChessboardDetections detections;
+	detections.image_size = image_size;
+	size_t found_count = std::count(pattern_found.begin(), pattern_found.end(), true);
+	detections.corners.Reserve(found_count, found_count * calibration_settings_.GetCalibrationBoardSize().area());
+	std::vector<uint64_t> accepted_hashes;
+	for (size_t index { 0 }; index < image_names.size(); ++index) {
+		if (pattern_found[index] && use_quality_filter) {
+			for (uint64_t accepted_hash : accepted_hashes) {
+				if (IsDuplicateImage(image_hashes[index], accepted_hash, calibration_settings_)) {
+					quality_issues[index] = ImageQualityIssue::DUPLICATE;
+					break;
+				}
+			}
+			if (quality_issues[index] == ImageQualityIssue::NONE) {
+				accepted_hashes.push_back(image_hashes[index]);
+			}
+		}
+
+		if (quality_issues[index] != ImageQualityIssue::NONE) {
+			detections.rejected_image_names.push_back(image_names[index]);
+			detections.rejection_reasons.push_back(quality_issues[index]);
+		}
+		else if (pattern_found[index]) {
+			detections.corners.AddView(corners_buffers[index]);
+			detections.image_names.push_back(image_names[index]);
+			detections.detection_stages.push_back(detection_stages[index]);
+		}
+	}
+
+	return detections;
+}
+
+
+} // namespace camera_calibration
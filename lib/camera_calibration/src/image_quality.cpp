@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/image_quality.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+// Longer side of the downsample the measurements are taken on.
+const int kQualityImageSide { 512 };
+// Gray levels counted as clipped.
+const uchar kDarkLevel { 16 };
+const uchar kBrightLevel { 239 };
+// dHash compares horizontally adjacent pixels of a 9x8 thumbnail.
+const cv::Size kHashImageSize { 9, 8 };
+
+int CountSetBits(uint64_t value)
+{
+	int count { 0 };
+	for (; value != 0; value &= value - 1) {
+		++count;
+	}
+	return count;
+}
+
+} // namespace
+
+
+ImageQuality MeasureImageQuality(const cv::Mat& image_gray)
+{
+	ImageQuality quality;
+
+	cv::Mat image_small = image_gray;
+	const int longer_side = std::max(image_gray.cols, image_gray.rows);
+	if (longer_side > kQualityImageSide) {
+		const double scale = static_cast<double>(kQualityImageSide) / longer_side;
+		cv::resize(image_gray, image_small, cv::Size(), scale, scale, cv::INTER_AREA);
+	}
+
+	cv::Mat laplacian;
+	cv::Laplacian(image_small, laplacian, CV_64F);
+	cv::Scalar mean;
+	cv::Scalar standard_deviation;
+	cv::meanStdDev(laplacian, mean, standard_deviation);
+	quality.sharpness = standard_deviation[0] * standard_deviation[0];
+
+	size_t dark_count { 0 };
+	size_t bright_count { 0 };
+	for (int row { 0 }; row < image_small.rows; ++row) {
+		const uchar* pixels = image_small.ptr<uchar>(row);
+		for (int column { 0 }; column < image_small.cols; ++column) {
+			dark_count += pixels[column] <= kDarkLevel;
+			bright_count += pixels[column] >= kBrightLevel;
+		}
+	}
+	const double pixel_count = static_cast<double>(std::max<size_t>(image_small.total(), 1));
+	quality.dark_fraction = dark_count / pixel_count;
+	quality.bright_fraction = bright_count / pixel_count;
+
+	cv::Mat image_hash;
+	cv::resize(image_small, image_hash, kHashImageSize, 0, 0, cv::INTER_AREA);
+	for (int row { 0 }; row < kHashImageSize.height; ++row) {
+		const uchar* pixels = image_hash.ptr<uchar>(row);
+		for (int column { 0 }; column + 1 < kHashImageSize.width; ++column) {
+			quality.hash = (quality.hash << 1) | (pixels[column] < pixels[column + 1] ? 1u : 0u);
+		}
+	}
+
+	return quality;
+}
+
+ImageQualityIssue CheckImageQuality(const ImageQuality& quality, const CameraCalibrationSettings& calibration_settings)
+{
+	if (quality.sharpness < calibration_settings.GetMinSharpness()) {
+		return ImageQualityIssue::BLURRY;
+	}
+	if (quality.dark_fraction > calibration_settings.GetMaxClippedFraction()) {
+		return ImageQualityIssue::UNDEREXPOSED;
+	}
+	if (quality.bright_fraction > calibration_settings.GetMaxClippedFraction()) {
+		return ImageQualityIssue::OVEREXPOSED;
+	}
+	return ImageQualityIssue::NONE;
+}
+
+bool IsDuplicateImage(uint64_t hash, uint64_t other_hash, const CameraCalibrationSettings& calibration_settings)
+{
+	return CountSetBits(hash ^ other_hash) < calibration_settings.GetDuplicateHashDistance();
+}
+
+std::string GetImageQualityIssueName(ImageQualityIssue issue)
+{
+	switch (issue) {
+	case ImageQualityIssue::BLURRY:
+		return "blurry";
+	case ImageQualityIssue::UNDEREXPOSED:
+		return "underexposed";
+	case ImageQualityIssue::OVEREXPOSED:
+		return "overexposed";
+	case ImageQualityIssue::DUPLICATE:
+		return "duplicate";
+	default:
+		return "none";
+	}
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,85 @@
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CAMERA_CALIBRATION_HAS_MMAP
+#endif
+
+#include "camera_calibration/mapped_file.h"
+
+namespace camera_calibration {
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#ifdef CAMERA_CALIBRATION_HAS_MMAP
+	int file_descriptor = ::open(filename.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		return false;
+	}
+
+	struct stat file_status;
+	if (::fstat(file_descriptor, &file_status) != 0 || file_status.st_size <= 0) {
+		::close(file_descriptor);
+		return false;
+	}
+
+	void* address = ::mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	::close(file_descriptor);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+
+	data_ = static_cast<const unsigned char*>(address);
+	size_ = static_cast<size_t>(file_status.st_size);
+	mapped_ = true;
+	return true;
+#else
+	std::ifstream fin(filename, std::ios::binary | std::ios::ate);
+	if (!fin.is_open()) {
+		return false;
+	}
+
+	std::streamoff file_size = fin.tellg();
+	if (file_size <= 0) {
+		return false;
+	}
+
+	buffer_.resize(static_cast<size_t>(file_size));
+	fin.seekg(0, std::ios::beg);
+	if (!fin.read(reinterpret_cast<char*>(buffer_.data()), file_size)) {
+		buffer_.clear();
+		return false;
+	}
+
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+	return true;
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef CAMERA_CALIBRATION_HAS_MMAP
+	if (mapped_) {
+		::munmap(const_cast<unsigned char*>(data_), size_);
+	}
+#endif
+	buffer_.clear();
+	data_ = nullptr;
+	size_ = 0;
+	mapped_ = false;
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/calibration_observations.h"
+#include "camera_calibration/parallel.h"
+#include "camera_calibration/sparse_calibration.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+// fx, fy, cx, cy, k1, k2, p1, p2, k3 - the column order of the cv::projectPoints Jacobian.
+const int kIntrinsicCount { 9 };
+// Rodrigues rotation vector followed by the translation vector.
+const int kPoseParameterCount { 6 };
+const int kDistortionCoefficientCount { 5 };
+const int kK3Index { 8 };
+
+// Number of views (spread evenly) used to guess the camera matrix.
+const size_t kInitializationViewCount { 50 };
+
+const double kInitialDamping { 1e-3 };
+const double kMaxDamping { 1e16 };
+
+typedef cv::Matx<double, kIntrinsicCount, kIntrinsicCount> IntrinsicMatrix;
+typedef cv::Matx<double, kIntrinsicCount, kPoseParameterCount> IntrinsicPoseMatrix;
+typedef cv::Matx<double, kPoseParameterCount, kPoseParameterCount> PoseMatrix;
+typedef cv::Vec<double, kIntrinsicCount> IntrinsicVector;
+typedef cv::Vec<double, kPoseParameterCount> PoseVector;
+
+// Normal equation blocks of one view: J^T J and J^T r split into the intrinsic (c)
+// and pose (p) parts.
+struct ViewNormalEquations
+{
+    IntrinsicMatrix intrinsic_block;     // Jc^T Jc
+    IntrinsicPoseMatrix coupling_block;  // Jc^T Jp
+    PoseMatrix pose_block;               // Jp^T Jp
+    IntrinsicVector intrinsic_gradient;  // Jc^T r
+    PoseVector pose_gradient;            // Jp^T r
+    double squared_error;
+};
+
+cv::Mat GetCameraMatrix(const IntrinsicVector& intrinsics)
+{
+	cv::Mat camera_matrix = cv::Mat::eye(3, 3, CV_64F);
+	camera_matrix.at<double>(0, 0) = intrinsics[0];
+	camera_matrix.at<double>(1, 1) = intrinsics[1];
+	camera_matrix.at<double>(0, 2) = intrinsics[2];
+	camera_matrix.at<double>(1, 2) = intrinsics[3];
+	return camera_matrix;
+}
+
+cv::Mat GetDistortionCoefficients(const IntrinsicVector& intrinsics)
+{
+	cv::Mat distortion_coefficients(kDistortionCoefficientCount, 1, CV_64F);
+	for (int i { 0 }; i < kDistortionCoefficientCount; ++i) {
+		distortion_coefficients.at<double>(i) = intrinsics[4 + i];
+	}
+	return distortion_coefficients;
+}
+
+void ProjectView(
+	const std::vector<cv::Point3d>& board_points,
+	const PoseVector& pose,
+	const cv::Mat& camera_matrix,
+	const cv::Mat& distortion_coefficients,
+	std::vector<cv::Point2d>& projected_points,
+	cv::OutputArray jacobian = cv::noArray())
+{
+	cv::Mat rotation_vector(3, 1, CV_64F, const_cast<double*>(pose.val));
+	cv::Mat translation_vector(3, 1, CV_64F, const_cast<double*>(pose.val + 3));
+	cv::projectPoints(
+		board_points,
+		rotation_vector,
+		translation_vector,
+		camera_matrix,
+		distortion_coefficients,
+		projected_points,
+		jacobian);
+}
+
+// projected_points holds the projection of the whole board for the view.
+// Returns the weighted squared error over the valid corners of the view.
+double GetSquaredError(
+	const std::vector<cv::Point2d>& projected_points,
+	const CornerDataset& corners,
+	size_t view)
+{
+	const float* x = corners.GetX();
+	const float* y = corners.GetY();
+	const float* weights = corners.GetWeights();
+	const int32_t* board_indices = corners.GetBoardIndices();
+	const uint8_t* valid = corners.GetValidFlags();
+
+	double squared_error { 0.0 };
+	for (size_t i = corners.GetViewBegin(view); i < corners.GetViewEnd(view); ++i) {
+		if (!valid[i]) {
+			continue;
+		}
+		const cv::Point2d& projected_point = projected_points[board_indices[i]];
+		double error_x = projected_point.x - x[i];
+		double error_y = projected_point.y - y[i];
+		squared_error += weights[i] * (error_x * error_x + error_y * error_y);
+	}
+	return squared_error;
+}
+
+void LinearizeView(
+	const std::vector<cv::Point3d>& board_points,
+	const CornerDataset& corners,
+	size_t view,
+	const PoseVector& pose,
+	const cv::Mat& camera_matrix,
+	const cv::Mat& distortion_coefficients,
+	ViewNormalEquations& equations)
+{
+	std::vector<cv::Point2d> projected_points;
+	cv::Mat jacobian;
+	ProjectView(board_points, pose, camera_matrix, distortion_coefficients, projected_points, jacobian);
+
+	equations.intrinsic_block = IntrinsicMatrix::zeros();
+	equations.coupling_block = IntrinsicPoseMatrix::zeros();
+	equations.pose_block = PoseMatrix::zeros();
+	equations.intrinsic_gradient = IntrinsicVector::all(0.0);
+	equations.pose_gradient = PoseVector::all(0.0);
+	equations.squared_error = 0.0;
+
+	const float* x = corners.GetX();
+	const float* y = corners.GetY();
+	const float* weights = corners.GetWeights();
+	const int32_t* board_indices = corners.GetBoardIndices();
+	const uint8_t* valid = corners.GetValidFlags();
+
+	// Jacobian columns: rotation (3), translation (3), focal lengths (2),
+	// principal point (2), distortion (5). Rows 2j and 2j + 1 belong to board point j.
+	for (size_t i = corners.GetViewBegin(view); i < corners.GetViewEnd(view); ++i) {
+		if (!valid[i]) {
+			continue;
+		}
+		const int board_index = board_indices[i];
+		const double weight = weights[i];
+		for (int axis { 0 }; axis < 2; ++axis) {
+			const double* row = jacobian.ptr<double>(2 * board_index + axis);
+			const double* intrinsic_row = row + kPoseParameterCount;
+			double residual = axis == 0 ?
+				projected_points[board_index].x - x[i] :
+				projected_points[board_index].y - y[i];
+
+			for (int a { 0 }; a < kPoseParameterCount; ++a) {
+				const double weighted_value = weight * row[a];
+				equations.pose_gradient[a] += weighted_value * residual;
+				for (int b { a }; b < kPoseParameterCount; ++b) {
+					equations.pose_block(a, b) += weighted_value * row[b];
+				}
+			}
+			for (int a { 0 }; a < kIntrinsicCount; ++a) {
+				const double weighted_value = weight * intrinsic_row[a];
+				equations.intrinsic_gradient[a] += weighted_value * residual;
+				for (int b { a }; b < kIntrinsicCount; ++b) {
+					equations.intrinsic_block(a, b) += weighted_value * intrinsic_row[b];
+				}
+				for (int b { 0 }; b < kPoseParameterCount; ++b) {
+					equations.coupling_block(a, b) += weighted_value * row[b];
+				}
+			}
+			equations.squared_error += weight * residual * residual;
+		}
+	}
+
+	for (int a { 0 }; a < kPoseParameterCount; ++a) {
+		for (int b { 0 }; b < a; ++b) {
+			equations.pose_block(a, b) = equations.pose_block(b, a);
+		}
+	}
+	for (int a { 0 }; a < kIntrinsicCount; ++a) {
+		for (int b { 0 }; b < a; ++b) {
+			equations.intrinsic_block(a, b) = equations.intrinsic_block(b, a);
+		}
+	}
+}
+
+IntrinsicVector InitializeIntrinsics(const CalibrationObservations& observations, const cv::Size& image_size)
+{
+	size_t view_count = std::min(observations.GetViewCount(), kInitializationViewCount);
+	std::vector<std::vector<cv::Point3f>> object_points(view_count);
+	std::vector<std::vector<cv::Point2f>> view_points(view_count);
+	for (size_t i { 0 }; i < view_count; ++i) {
+		observations.GetViewPoints(i * observations.GetViewCount() / view_count, object_points[i], view_points[i]);
+	}
+
+	cv::Mat camera_matrix = cv::initCameraMatrix2D(object_points, view_points, image_size);
+
+	IntrinsicVector intrinsics = IntrinsicVector::all(0.0);
+	intrinsics[0] = camera_matrix.at<double>(0, 0);
+	intrinsics[1] = camera_matrix.at<double>(1, 1);
+	intrinsics[2] = camera_matrix.at<double>(0, 2);
+	intrinsics[3] = camera_matrix.at<double>(1, 2);
+	return intrinsics;
+}
+
+PoseVector InitializePose(const CalibrationObservations& observations, size_t view, const cv::Mat& camera_matrix)
+{
+	std::vector<cv::Point3f> object_points;
+	std::vector<cv::Point2f> view_points;
+	observations.GetViewPoints(view, object_points, view_points);
+
+	cv::Mat rotation_vector;
+	cv::Mat translation_vector;
+	if (!cv::solvePnP(object_points, view_points, camera_matrix, cv::noArray(), rotation_vector, translation_vector)) {
+		throw CameraCalibrationExeption("unable to estimate initial view pose");
+	}
+
+	PoseVector pose;
+	for (int i { 0 }; i < 3; ++i) {
+		pose[i] = rotation_vector.at<double>(i);
+		pose[3 + i] = translation_vector.at<double>(i);
+	}
+	return pose;
+}
+
+} // namespace
+
+
+double CalibrateCameraSparse(
+	const CalibrationObservations& observations,
+	const cv::Size& image_size,
+	cv::Mat& camera_matrix,
+	cv::Mat& distortion_coefficients,
+	std::vector<cv::Mat>& rotation_vectors,
+	std::vector<cv::Mat>& translation_vectors,
+	int thread_count,
+	const cv::TermCriteria& criteria,
+	int flags)
+{
+	if (flags & ~cv::CALIB_FIX_K3) {
+		throw CameraCalibrationExeption("unsupported sparse calibration flags");
+	}
+	const bool fix_k3 = (flags & cv::CALIB_FIX_K3) != 0;
+
+	const size_t view_count = observations.GetViewCount();
+	if (view_count == 0) {
+		throw CameraCalibrationExeption("no views to calibrate on");
+	}
+	const CornerDataset& corners = observations.GetCorners();
+	double weight_sum { 0.0 };
+	for (size_t view { 0 }; view < view_count; ++view) {
+		size_t valid_corner_count { 0 };
+		for (size_t i = corners.GetViewBegin(view); i < corners.GetViewEnd(view); ++i) {
+			if (corners.IsValid(i)) {
+				weight_sum += corners.GetWeight(i);
+				++valid_corner_count;
+			}
+		}
+		if (valid_corner_count < 4) {
+			throw CameraCalibrationExeption("view has too few corners");
+		}
+	}
+	if (weight_sum <= 0.0) {
+		throw CameraCalibrationExeption("corner weights must be positive");
+	}
+
+	const int max_iteration_count = (criteria.type & cv::TermCriteria::COUNT) ? criteria.maxCount : 100;
+	const double epsilon = (criteria.type & cv::TermCriteria::EPS) ? criteria.epsilon : 0.0;
+	std::vector<cv::Point3d> board(observations.GetBoardPoints().begin(), observations.GetBoardPoints().end());
+
+	// The Levenberg-Marquardt loop runs several short parallel passes per iteration, so
+	// the workers are started once for the whole solve.
+	ThreadPool thread_pool(static_cast<int>(std::min<size_t>(ResolveThreadCount(thread_count), view_count)));
+
+	IntrinsicVector intrinsics = InitializeIntrinsics(observations, image_size);
+	std::vector<PoseVector> poses(view_count);
+	{
+		cv::Mat initial_camera_matrix = GetCameraMatrix(intrinsics);
+		thread_pool.Run(view_count, [&](size_t view) {
+			poses[view] = InitializePose(observations, view, initial_camera_matrix);
+		});
+	}
+
+	std::vector<ViewNormalEquations> equations(view_count);
+	std::vector<PoseMatrix> inverse_pose_blocks(view_count);
+	std::vector<IntrinsicPoseMatrix> reduced_couplings(view_count);
+	std::vector<PoseVector> trial_poses(view_count);
+	std::vector<double> trial_errors(view_count);
+
+	double damping = kInitialDamping;
+	double squared_error { 0.0 };
+
+	for (int iteration { 0 }; iteration < max_iteration_count; ++iteration) {
+		cv::Mat iteration_camera_matrix = GetCameraMatrix(intrinsics);
+		cv::Mat iteration_distortion_coefficients = GetDistortionCoefficients(intrinsics);
+		thread_pool.Run(view_count, [&](size_t view) {
+			LinearizeView(
+				board,
+				corners,
+				view,
+				poses[view],
+				iteration_camera_matrix,
+				iteration_distortion_coefficients,
+				equations[view]);
+		});
+
+		IntrinsicMatrix intrinsic_block = IntrinsicMatrix::zeros();
+		IntrinsicVector intrinsic_gradient = IntrinsicVector::all(0.0);
+		squared_error = 0.0;
+		for (const auto& view_equations : equations) {
+			intrinsic_block += view_equations.intrinsic_block;
+			intrinsic_gradient += view_equations.intrinsic_gradient;
+			squared_error += view_equations.squared_error;
+		}
+
+		bool step_accepted { false };
+		double trial_squared_error { 0.0 };
+		IntrinsicVector trial_intrinsics;
+
+		while (!step_accepted && damping < kMaxDamping) {
+			// Eliminate the poses: S = U - sum(W V^-1 W^T), b = -gc + sum(W V^-1 gp).
+			std::atomic<bool> pose_blocks_valid { true };
+			thread_pool.Run(view_count, [&](size_t view) {
+				PoseMatrix pose_block = equations[view].pose_block;
+				for (int i { 0 }; i < kPoseParameterCount; ++i) {
+					pose_block(i, i) *= 1.0 + damping;
+				}
+				bool inverted { false };
+				inverse_pose_blocks[view] = pose_block.inv(cv::DECOMP_CHOLESKY, &inverted);
+				reduced_couplings[view] = equations[view].coupling_block * inverse_pose_blocks[view];
+				if (!inverted) {
+					pose_blocks_valid = false;
+				}
+			});
+
+			IntrinsicMatrix schur_complement = intrinsic_block;
+			IntrinsicVector schur_gradient = -intrinsic_gradient;
+			for (int i { 0 }; i < kIntrinsicCount; ++i) {
+				schur_complement(i, i) *= 1.0 + damping;
+			}
+			for (size_t view { 0 }; view < view_count; ++view) {
+				schur_complement -= reduced_couplings[view] * equations[view].coupling_block.t();
+				schur_gradient += reduced_couplings[view] * equations[view].pose_gradient;
+			}
+			if (fix_k3) {
+				// Drop k3 from the system: it keeps its initial value of zero.
+				for (int i { 0 }; i < kIntrinsicCount; ++i) {
+					schur_complement(kK3Index, i) = 0.0;
+					schur_complement(i, kK3Index) = 0.0;
+				}
+				schur_complement(kK3Index, kK3Index) = 1.0;
+				schur_gradient[kK3Index] = 0.0;
+			}
+
+			IntrinsicVector intrinsic_step;
+			if (!pose_blocks_valid || !cv::solve(schur_complement, schur_gradient, intrinsic_step, cv::DECOMP_CHOLESKY)) {
+				damping *= 10.0;
+				continue;
+			}
+
+			trial_intrinsics = intrinsics + intrinsic_step;
+			cv::Mat trial_camera_matrix = GetCameraMatrix(trial_intrinsics);
+			cv::Mat trial_distortion_coefficients = GetDistortionCoefficients(trial_intrinsics);
+			thread_pool.Run(view_count, [&](size_t view) {
+				PoseVector pose_step = inverse_pose_blocks[view] *
+					(-equations[view].pose_gradient - equations[view].coupling_block.t() * intrinsic_step);
+				trial_poses[view] = poses[view] + pose_step;
+
+				std::vector<cv::Point2d> projected_points;
+				ProjectView(board, trial_poses[view], trial_camera_matrix, trial_distortion_coefficients, projected_points);
+				trial_errors[view] = GetSquaredError(projected_points, corners, view);
+			});
+
+			trial_squared_error = 0.0;
+			for (double view_error : trial_errors) {
+				trial_squared_error += view_error;
+			}
+
+			if (trial_squared_error < squared_error) {
+				step_accepted = true;
+				damping = std::max(damping * 0.1, 1e-12);
+			}
+			else {
+				damping *= 10.0;
+			}
+		}
+
+		if (!step_accepted) {
+			break;
+		}
+
+		double relative_decrease = (squared_error - trial_squared_error) / std::max(squared_error, 1e-300);
+		intrinsics = trial_intrinsics;
+		poses.swap(trial_poses);
+		squared_error = trial_squared_error;
+
+		if (relative_decrease <= epsilon) {
+			break;
+		}
+	}
+
+	camera_matrix = GetCameraMatrix(intrinsics);
+	distortion_coefficients = cv::Mat::zeros(8, 1, CV_64F);
+	for (int i { 0 }; i < kDistortionCoefficientCount; ++i) {
+		distortion_coefficients.at<double>(i) = intrinsics[4 + i];
+	}
+
+	rotation_vectors.resize(view_count);
+	translation_vectors.resize(view_count);
+	for (size_t view { 0 }; view < view_count; ++view) {
+		rotation_vectors[view] = cv::Mat(3, 1, CV_64F, poses[view].val).clone();
+		translation_vectors[view] = cv::Mat(3, 1, CV_64F, poses[view].val + 3).clone();
+	}
+
+	return std::sqrt(squared_error / weight_sum);
+}
+
+
+} // namespace camera_calibration
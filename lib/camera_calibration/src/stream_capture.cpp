@@ -0,0 +1,98 @@
+#include <chrono>
+
+#include "camera_calibration/stream_capture.h"
+
+namespace camera_calibration {
+
+
+StreamCapture::~StreamCapture()
+{
+	Close();
+}
+
+bool StreamCapture::Open(const std::string& source)
+{
+	Close();
+
+	if (!capture_.open(source)) {
+		return false;
+	}
+
+	// Keep as little as possible queued inside the backend; not every backend supports it.
+	capture_.set(cv::CAP_PROP_BUFFERSIZE, 1);
+
+	stop_ = false;
+	running_ = true;
+	capture_thread_ = std::thread(&StreamCapture::Run, this);
+	return true;
+}
+
+void StreamCapture::Close()
+{
+	stop_ = true;
+	if (capture_thread_.joinable()) {
+		capture_thread_.join();
+	}
+	capture_.release();
+	running_ = false;
+}
+
+bool StreamCapture::Read(cv::Mat& frame, int timeout_ms)
+{
+	if (!frames_.Acquire()) {
+		std::unique_lock<std::mutex> lock(frame_mutex_);
+		frame_published_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { 
+			return frames_.HasNewFrame() || !running_; 
+		});
+		if (!frames_.Acquire()) {
+			return false;
+		}
+	}
+
+	frame = frames_.GetReadFrame();
+	return true;
+}
+
+void StreamCapture::Run()
+{
+	while (!stop_) {
+		if (!capture_.grab()) {
+			break;
+		}
+		++grabbed_frame_count_;
+
+		// Decoding is the expensive part, so frames grabbed while the previous one is
+		// still unread are skipped.
+		if (frames_.HasNewFrame()) {
+			++dropped_frame_count_;
+			continue;
+		}
+
+		if (!capture_.retrieve(frames_.GetWriteFrame()) || frames_.GetWriteFrame().empty()) {
+			++dropped_frame_count_;
+			continue;
+		}
+		++retrieved_frame_count_;
+
+		if (frames_.Publish()) {
+			++dropped_frame_count_;
+		}
+		NotifyReader();
+	}
+
+	running_ = false;
+	NotifyReader();
+}
+
+void StreamCapture::NotifyReader()
+{
+	// Taking the mutex orders the notification after a reader's predicate check, so
+	// the wake-up cannot fall between the check and the wait.
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex_);
+	}
+	frame_published_.notify_one();
+}
+
+
+} // namespace camera_calibration
@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/undistortion.h"
+#include "camera_calibration/hash.h"
+#include "camera_calibration/mapped_file.h"
+#include "camera_calibration/parallel.h"
+
+namespace camera_calibration {
+
+
+namespace {
+
+const char kUndistortionMapsMagic[8] { 'U', 'N', 'D', 'M', 'A', 'P', 'S', '\0' };
+const uint32_t kUndistortionMapsVersion { 1 };
+
+struct UndistortionMapsHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t camera_parameters_hash;
+
+	int32_t image_width;
+	int32_t image_height;
+	double alpha;
+	int32_t map_type;
+	int32_t map1_type;
+	int32_t map2_type;
+	int32_t reserved;
+
+	uint64_t map1_offset;
+	uint64_t map1_size;
+	uint64_t map2_offset;
+	uint64_t map2_size;
+	double new_camera_matrix[9];
+};
+
+// Minimum number of rows a remap stripe should have to be worth a task.
+const int kMinimumStripeRows { 32 };
+
+uint64_t HashCameraParameters(const CameraParameters& camera_parameters)
+{
+	cv::Mat camera_matrix;
+	cv::Mat distortion_coefficients;
+	camera_parameters.GetCameraMatrix().convertTo(camera_matrix, CV_64F);
+	camera_parameters.GetDistrotionCoefficients().convertTo(distortion_coefficients, CV_64F);
+	camera_matrix = camera_matrix.clone();
+	distortion_coefficients = distortion_coefficients.clone();
+
+	uint64_t hash = HashBytes(camera_matrix.data, camera_matrix.total() * sizeof(double));
+	return HashBytes(distortion_coefficients.data, distortion_coefficients.total() * sizeof(double), hash);
+}
+
+bool IsSupportedMapType(int map_type)
+{
+	return map_type == CV_16SC2 || map_type == CV_32FC1 || map_type == CV_32FC2;
+}
+
+size_t GetMatrixSize(const cv::Mat& matrix)
+{
+	return matrix.total() * matrix.elemSize();
+}
+
+// Types initUndistortRectifyMap gives map1 and map2 (-1: no map2) for a map type, with
+// their element sizes in bytes.
+void GetMapLayout(int map_type, int& map1_type, size_t& map1_element_size, int& map2_type, size_t& map2_element_size)
+{
+	map2_type = -1;
+	map2_element_size = 0;
+	if (map_type == CV_16SC2) {
+		map1_type = CV_16SC2;
+		map1_element_size = 2 * sizeof(int16_t);
+		map2_type = CV_16UC1;
+		map2_element_size = sizeof(uint16_t);
+	}
+	else if (map_type == CV_32FC1) {
+		map1_type = CV_32FC1;
+		map1_element_size = sizeof(float);
+		map2_type = CV_32FC1;
+		map2_element_size = sizeof(float);
+	}
+	else {
+		map1_type = CV_32FC2;
+		map1_element_size = 2 * sizeof(float);
+	}
+}
+
+// remap addresses pixels with 16-bit fixed-point coordinates.
+const int32_t kMaximumMapSide { 32767 };
+
+// Number of samples per axis used to fit the inverse distortion model.
+const int kInverseDistortionSampleCount { 96 };
+
+// Evaluates the (up to 8-coefficient) forward distortion model on normalized coordinates.
+cv::Point2d DistortNormalizedPoint(const cv::Point2d& point, const double* k)
+{
+	double r2 = point.x * point.x + point.y * point.y;
+	double radial = (1.0 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2) / (1.0 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2);
+	return cv::Point2d(
+		point.x * radial + 2.0 * k[2] * point.x * point.y + k[3] * (r2 + 2.0 * point.x * point.x),
+		point.y * radial + k[2] * (r2 + 2.0 * point.y * point.y) + 2.0 * k[3] * point.x * point.y);
+}
+
+cv::Point2d EvaluateInverseDistortion(const cv::Point2d& point, const double* c)
+{
+	double r2 = point.x * point.x + point.y * point.y;
+	double radial = 1.0 + r2 * (c[0] + r2 * (c[1] + r2 * (c[2] + r2 * (c[3] + r2 * c[4]))));
+	return cv::Point2d(
+		point.x * radial + 2.0 * c[5] * point.x * point.y + c[6] * (r2 + 2.0 * point.x * point.x),
+		point.y * radial + c[5] * (r2 + 2.0 * point.y * point.y) + 2.0 * c[6] * point.x * point.y);
+}
+
+} // namespace
+
+
+Undistorter::Undistorter(const CameraParameters& camera_parameters, int thread_count)
+	: camera_parameters_(camera_parameters),
+	  camera_parameters_hash_(HashCameraParameters(camera_parameters)),
+	  thread_count_(thread_count)
+{
+}
+
+std::shared_ptr<const UndistortionMaps> Undistorter::GetMaps(const cv::Size& image_size, double alpha, int map_type)
+{
+	if (!IsSupportedMapType(map_type)) {
+		throw CameraCalibrationExeption("unsupported undistortion map type");
+	}
+
+	MapsKey key { image_size.width, image_size.height, alpha, map_type };
+	std::lock_guard<std::mutex> lock(maps_mutex_);
+
+	auto maps_iterator = maps_.find(key);
+	if (maps_iterator != maps_.end()) {
+		return maps_iterator->second;
+	}
+
+	std::shared_ptr<UndistortionMaps> maps = std::make_shared<UndistortionMaps>();
+	maps->image_size = image_size;
+	maps->alpha = alpha;
+	maps->map_type = map_type;
+	maps->new_camera_matrix = cv::getOptimalNewCameraMatrix(
+		camera_parameters_.GetCameraMatrix(),
+		camera_parameters_.GetDistrotionCoefficients(),
+		image_size,
+		alpha,
+		image_size);
+	cv::initUndistortRectifyMap(
+		camera_parameters_.GetCameraMatrix(),
+		camera_parameters_.GetDistrotionCoefficients(),
+		cv::Mat(),
+		maps->new_camera_matrix,
+		image_size,
+		map_type,
+		maps->map1,
+		maps->map2);
+
+	maps_[key] = maps;
+	return maps;
+}
+
+void Undistorter::Undistort(const cv::Mat& frame, cv::Mat& undistorted_frame, double alpha, int map_type)
+{
+	std::shared_ptr<const UndistortionMaps> maps = GetMaps(frame.size(), alpha, map_type);
+
+	cv::Mat source = frame;
+	if (source.data == undistorted_frame.data) {
+		source = frame.clone();
+	}
+	undistorted_frame.create(frame.size(), frame.type());
+
+	int stripe_count = std::max(1, std::min(4 * ResolveThreadCount(thread_count_), frame.rows / kMinimumStripeRows));
+	ParallelFor(stripe_count, thread_count_, [&](size_t stripe) {
+		int first_row = static_cast<int>(stripe * frame.rows / stripe_count);
+		int last_row = static_cast<int>((stripe + 1) * frame.rows / stripe_count);
+
+		cv::Mat undistorted_stripe = undistorted_frame.rowRange(first_row, last_row);
+		cv::remap(
+			source,
+			undistorted_stripe,
+			maps->map1.rowRange(first_row, last_row),
+			maps->map2.empty() ? cv::Mat() : maps->map2.rowRange(first_row, last_row),
+			cv::INTER_LINEAR,
+			cv::BORDER_CONSTANT);
+	});
+}
+
+bool Undistorter::SaveMapsToFile(const std::string& filename, const cv::Size& image_size, double alpha, int map_type)
+{
+	std::shared_ptr<const UndistortionMaps> maps = GetMaps(image_size, alpha, map_type);
+	cv::Mat map1 = maps->map1.isContinuous() ? maps->map1 : maps->map1.clone();
+	cv::Mat map2 = maps->map2.isContinuous() ? maps->map2 : maps->map2.clone();
+	cv::Mat new_camera_matrix;
+	maps->new_camera_matrix.convertTo(new_camera_matrix, CV_64F);
+
+	UndistortionMapsHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, kUndistortionMapsMagic, sizeof(header.magic));
+	header.version = kUndistortionMapsVersion;
+	header.header_size = sizeof(header);
+	header.camera_parameters_hash = camera_parameters_hash_;
+	header.image_width = image_size.width;
+	header.image_height = image_size.height;
+	header.alpha = alpha;
+	header.map_type = map_type;
+	header.map1_type = map1.type();
+	header.map2_type = map2.empty() ? -1 : map2.type();
+	header.map1_offset = sizeof(header);
+	header.map1_size = GetMatrixSize(map1);
+	header.map2_offset = header.map1_offset + header.map1_size;
+	header.map2_size = GetMatrixSize(map2);
+	for (int i { 0 }; i < 9; ++i) {
+		header.new_camera_matrix[i] = new_camera_matrix.at<double>(i / 3, i % 3);
+	}
+
+	std::ofstream fout(filename, std::ios::binary);
+	if (!fout.is_open()) {
+		return false;
+	}
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(map1.data), header.map1_size);
+	if (!map2.empty()) {
+		fout.write(reinterpret_cast<const char*>(map2.data), header.map2_size);
+	}
+
+	fout.close();
+	return static_cast<bool>(fout);
+}
+
+bool Undistorter::LoadMapsFromFile(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename) || file.GetSize() < sizeof(UndistortionMapsHeader)) {
+		return false;
+	}
+
+	UndistortionMapsHeader header;
+	std::memcpy(&header, file.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, kUndistortionMapsMagic, sizeof(header.magic)) != 0 ||
+		header.version != kUndistortionMapsVersion ||
+		header.header_size != sizeof(header) ||
+		header.camera_parameters_hash != camera_parameters_hash_ ||
+		!IsSupportedMapType(header.map_type) ||
+		header.image_width <= 0 || header.image_width > kMaximumMapSide ||
+		header.image_height <= 0 || header.image_height > kMaximumMapSide)
+	{
+		return false;
+	}
+
+	// Everything the allocation below depends on must match what GetMaps would have
+	// built for this image size and map type, and the maps must lie inside the file.
+	int map1_type;
+	int map2_type;
+	size_t map1_element_size;
+	size_t map2_element_size;
+	GetMapLayout(header.map_type, map1_type, map1_element_size, map2_type, map2_element_size);
+	const uint64_t pixel_count = static_cast<uint64_t>(header.image_width) * header.image_height;
+	if (header.map1_type != map1_type || header.map2_type != map2_type ||
+		header.map1_size != pixel_count * map1_element_size ||
+		header.map2_size != pixel_count * map2_element_size ||
+		header.map1_offset != sizeof(header) ||
+		header.map2_offset != header.map1_offset + header.map1_size ||
+		header.map2_offset + header.map2_size > file.GetSize())
+	{
+		return false;
+	}
+
+	std::shared_ptr<UndistortionMaps> maps = std::make_shared<UndistortionMaps>();
+	maps->image_size = cv::Size(header.image_width, header.image_height);
+	maps->alpha = header.alpha;
+	maps->map_type = header.map_type;
+	maps->new_camera_matrix = cv::Mat(3, 3, CV_64F, header.new_camera_matrix).clone();
+
+	maps->map1.create(maps->image_size, header.map1_type);
+	if (GetMatrixSize(maps->map1) != header.map1_size) {
+		return false;
+	}
+	std::memcpy(maps->map1.data, file.GetData() + header.map1_offset, header.map1_size);
+
+	if (header.map2_type >= 0) {
+		maps->map2.create(maps->image_size, header.map2_type);
+		if (GetMatrixSize(maps->map2) != header.map2_size) {
+			return false;
+		}
+		std::memcpy(maps->map2.data, file.GetData() + header.map2_offset, header.map2_size);
+	}
+
+	MapsKey key { header.image_width, header.image_height, header.alpha, header.map_type };
+	std::lock_guard<std::mutex> lock(maps_mutex_);
+	maps_[key] = maps;
+	return true;
+}
+
+
+RationalDistortionModel GetRationalDistortionModel(const CameraParameters& camera_parameters)
+{
+	cv::Mat camera_matrix;
+	cv::Mat distortion_coefficients;
+	camera_parameters.GetCameraMatrix().convertTo(camera_matrix, CV_64F);
+	camera_parameters.GetDistrotionCoefficients().convertTo(distortion_coefficients, CV_64F);
+	distortion_coefficients = distortion_coefficients.reshape(1, 1);
+	if (distortion_coefficients.cols > 8) {
+		throw CameraCalibrationExeption("distortion model is not supported by the vectorized kernel");
+	}
+
+	double coefficients[8] { 0.0 };
+	for (int i { 0 }; i < distortion_coefficients.cols; ++i) {
+		coefficients[i] = distortion_coefficients.at<double>(0, i);
+	}
+
+	return RationalDistortionModel {
+		static_cast<float>(camera_matrix.at<double>(0, 0)),
+		static_cast<float>(camera_matrix.at<double>(1, 1)),
+		static_cast<float>(camera_matrix.at<double>(0, 2)),
+		static_cast<float>(camera_matrix.at<double>(1, 2)),
+		static_cast<float>(coefficients[0]),
+		static_cast<float>(coefficients[1]),
+		static_cast<float>(coefficients[2]),
+		static_cast<float>(coefficients[3]),
+		static_cast<float>(coefficients[4]),
+		static_cast<float>(coefficients[5]),
+		static_cast<float>(coefficients[6]),
+		static_cast<float>(coefficients[7]) };
+}
+
+void UndistortPointsVectorized(
+	const cv::Point2f* src,
+	cv::Point2f* dst,
+	size_t point_count,
+	const CameraParameters& camera_parameters,
+	int iteration_count,
+	float epsilon)
+{
+	UndistortPointsVectorized(
+		GetRationalDistortionModel(camera_parameters),
+		reinterpret_cast<const float*>(src),
+		reinterpret_cast<float*>(dst),
+		point_count,
+		iteration_count,
+		epsilon);
+}
+
+void FitInverseDistortionModel(CameraParameters& camera_parameters, const cv::Size& image_size)
+{
+	cv::Mat camera_matrix;
+	cv::Mat distortion_coefficients;
+	camera_parameters.GetCameraMatrix().convertTo(camera_matrix, CV_64F);
+	camera_parameters.GetDistrotionCoefficients().convertTo(distortion_coefficients, CV_64F);
+	distortion_coefficients = distortion_coefficients.reshape(1, 1);
+	if (distortion_coefficients.cols > 8) {
+		throw CameraCalibrationExeption("distortion model is not supported by the inverse distortion fit");
+	}
+
+	double k[8] { 0.0 };
+	for (int i { 0 }; i < distortion_coefficients.cols; ++i) {
+		k[i] = distortion_coefficients.at<double>(0, i);
+	}
+	const double fx = camera_matrix.at<double>(0, 0);
+	const double fy = camera_matrix.at<double>(1, 1);
+	const double cx = camera_matrix.at<double>(0, 2);
+	const double cy = camera_matrix.at<double>(1, 2);
+
+	if (image_size.width < 2 || image_size.height < 2) {
+		throw CameraCalibrationExeption("image is too small for the inverse distortion fit");
+	}
+
+	// Undistorted region that covers the image, from its border.
+	std::vector<cv::Point2f> border;
+	for (int i { 0 }; i <= kInverseDistortionSampleCount; ++i) {
+		float x = static_cast<float>(i) * (image_size.width - 1) / kInverseDistortionSampleCount;
+		float y = static_cast<float>(i) * (image_size.height - 1) / kInverseDistortionSampleCount;
+		border.push_back(cv::Point2f(x, 0.0f));
+		border.push_back(cv::Point2f(x, image_size.height - 1.0f));
+		border.push_back(cv::Point2f(0.0f, y));
+		border.push_back(cv::Point2f(image_size.width - 1.0f, y));
+	}
+	UndistortPoints(border.data(), border.data(), border.size(), camera_parameters);
+
+	cv::Point2d bounds_min(border[0].x, border[0].y);
+	cv::Point2d bounds_max(border[0].x, border[0].y);
+	for (const auto& point : border) {
+		bounds_min.x = std::min<double>(bounds_min.x, point.x);
+		bounds_min.y = std::min<double>(bounds_min.y, point.y);
+		bounds_max.x = std::max<double>(bounds_max.x, point.x);
+		bounds_max.y = std::max<double>(bounds_max.y, point.y);
+	}
+	double margin = 0.05 * std::max(bounds_max.x - bounds_min.x, bounds_max.y - bounds_min.y);
+	bounds_min -= cv::Point2d(margin, margin);
+	bounds_max += cv::Point2d(margin, margin);
+
+	// Exact pairs come from sampling the undistorted region and applying the forward model.
+	std::vector<cv::Point2d> distorted_points;
+	std::vector<cv::Point2d> undistorted_points;
+	for (int row { 0 }; row <= kInverseDistortionSampleCount; ++row) {
+		for (int column { 0 }; column <= kInverseDistortionSampleCount; ++column) {
+			cv::Point2d undistorted(
+				bounds_min.x + (bounds_max.x - bounds_min.x) * column / kInverseDistortionSampleCount,
+				bounds_min.y + (bounds_max.y - bounds_min.y) * row / kInverseDistortionSampleCount);
+			cv::Point2d distorted = DistortNormalizedPoint(undistorted, k);
+			double u = fx * distorted.x + cx;
+			double v = fy * distorted.y + cy;
+			if (u >= 0.0 && v >= 0.0 && u <= image_size.width - 1.0 && v <= image_size.height - 1.0) {
+				distorted_points.push_back(distorted);
+				undistorted_points.push_back(undistorted);
+			}
+		}
+	}
+
+	if (distorted_points.size() < kInverseDistortionCoefficientCount) {
+		throw CameraCalibrationExeption("unable to sample the distortion model over the image");
+	}
+
+	int sample_count = static_cast<int>(distorted_points.size());
+	cv::Mat design(2 * sample_count, kInverseDistortionCoefficientCount, CV_64F);
+	cv::Mat target(2 * sample_count, 1, CV_64F);
+	for (int i { 0 }; i < sample_count; ++i) {
+		const cv::Point2d& d = distorted_points[i];
+		double r2 = d.x * d.x + d.y * d.y;
+		double* row_x = design.ptr<double>(2 * i);
+		double* row_y = design.ptr<double>(2 * i + 1);
+		double r2_power = r2;
+		for (int j { 0 }; j < 5; ++j) {
+			row_x[j] = d.x * r2_power;
+			row_y[j] = d.y * r2_power;
+			r2_power *= r2;
+		}
+		row_x[5] = 2.0 * d.x * d.y;
+		row_x[6] = r2 + 2.0 * d.x * d.x;
+		row_y[5] = r2 + 2.0 * d.y * d.y;
+		row_y[6] = 2.0 * d.x * d.y;
+		target.at<double>(2 * i) = undistorted_points[i].x - d.x;
+		target.at<double>(2 * i + 1) = undistorted_points[i].y - d.y;
+	}
+
+	cv::Mat inverse_coefficients;
+	cv::solve(design, target, inverse_coefficients, cv::DECOMP_SVD);
+
+	double max_error { 0.0 };
+	double squared_error_sum { 0.0 };
+	for (int i { 0 }; i < sample_count; ++i) {
+		cv::Point2d estimate = EvaluateInverseDistortion(distorted_points[i], inverse_coefficients.ptr<double>());
+		double error_x = (estimate.x - undistorted_points[i].x) * fx;
+		double error_y = (estimate.y - undistorted_points[i].y) * fy;
+		double squared_error = error_x * error_x + error_y * error_y;
+		max_error = std::max(max_error, std::sqrt(squared_error));
+		squared_error_sum += squared_error;
+	}
+
+	camera_parameters.SetInverseDistortionCoefficients(inverse_coefficients);
+	camera_parameters.SetInverseDistortionMaxError(max_error);
+	camera_parameters.SetInverseDistortionRmsError(std::sqrt(squared_error_sum / sample_count));
+}
+
+bool TryFitInverseDistortionModel(CameraParameters& camera_parameters, const cv::Size& image_size)
+{
+	try {
+		FitInverseDistortionModel(camera_parameters, image_size);
+		return true;
+	}
+	catch (const CameraCalibrationExeption&) {
+		camera_parameters.SetInverseDistortionCoefficients(cv::Mat());
+		camera_parameters.SetInverseDistortionMaxError(0.0);
+		camera_parameters.SetInverseDistortionRmsError(0.0);
+		return false;
+	}
+}
+
+void UndistortPointsClosedForm(
+	const cv::Point2f* src,
+	cv::Point2f* dst,
+	size_t point_count,
+	const CameraParameters& camera_parameters)
+{
+	if (camera_parameters.GetInverseDistortionCoefficients().empty()) {
+		UndistortPoints(src, dst, point_count, camera_parameters);
+		return;
+	}
+
+	cv::Mat inverse_coefficients;
+	camera_parameters.GetInverseDistortionCoefficients().convertTo(inverse_coefficients, CV_64F);
+	if (inverse_coefficients.total() != kInverseDistortionCoefficientCount) {
+		throw CameraCalibrationExeption("unexpected inverse distortion model size");
+	}
+	inverse_coefficients = inverse_coefficients.clone();
+
+	cv::Mat camera_matrix;
+	camera_parameters.GetCameraMatrix().convertTo(camera_matrix, CV_64F);
+	const double inverse_fx = 1.0 / camera_matrix.at<double>(0, 0);
+	const double inverse_fy = 1.0 / camera_matrix.at<double>(1, 1);
+	const double cx = camera_matrix.at<double>(0, 2);
+	const double cy = camera_matrix.at<double>(1, 2);
+	const double* c = inverse_coefficients.ptr<double>();
+
+	for (size_t i { 0 }; i < point_count; ++i) {
+		cv::Point2d distorted((src[i].x - cx) * inverse_fx, (src[i].y - cy) * inverse_fy);
+		cv::Point2d undistorted = EvaluateInverseDistortion(distorted, c);
+		dst[i] = cv::Point2f(static_cast<float>(undistorted.x), static_cast<float>(undistorted.y));
+	}
+}
+
+UndistortionLut::UndistortionLut(const CameraParameters& camera_parameters, const cv::Size& image_size, float grid_pitch)
+	: image_size_(image_size),
+	  grid_pitch_(grid_pitch),
+	  inverse_grid_pitch_(1.0f / grid_pitch)
+{
+	if (grid_pitch <= 0.0f || image_size.empty()) {
+		throw CameraCalibrationExeption("invalid undistortion lookup table grid");
+	}
+
+	grid_columns_ = std::max(2, static_cast<int>(std::ceil((image_size.width - 1) / grid_pitch)) + 1);
+	grid_rows_ = std::max(2, static_cast<int>(std::ceil((image_size.height - 1) / grid_pitch)) + 1);
+
+	grid_.resize(static_cast<size_t>(grid_columns_) * grid_rows_);
+	for (int row { 0 }; row < grid_rows_; ++row) {
+		for (int column { 0 }; column < grid_columns_; ++column) {
+			grid_[row * grid_columns_ + column] = cv::Point2f(column * grid_pitch, row * grid_pitch);
+		}
+	}
+	UndistortPoints(grid_.data(), grid_.data(), grid_.size(), camera_parameters);
+
+	std::vector<cv::Point2f> probes;
+	probes.reserve(3 * grid_.size());
+	for (int row { 0 }; row + 1 < grid_rows_; ++row) {
+		for (int column { 0 }; column + 1 < grid_columns_; ++column) {
+			float x = column * grid_pitch;
+			float y = row * grid_pitch;
+			probes.push_back(cv::Point2f(x + 0.5f * grid_pitch, y + 0.5f * grid_pitch));
+			probes.push_back(cv::Point2f(x + 0.5f * grid_pitch, y));
+			probes.push_back(cv::Point2f(x, y + 0.5f * grid_pitch));
+		}
+	}
+
+	std::vector<cv::Point2f> exact_points(probes.size());
+	UndistortPoints(probes.data(), exact_points.data(), probes.size(), camera_parameters);
+
+	cv::Mat camera_matrix;
+	camera_parameters.GetCameraMatrix().convertTo(camera_matrix, CV_64F);
+	const double focal_x = camera_matrix.at<double>(0, 0);
+	const double focal_y = camera_matrix.at<double>(1, 1);
+	for (size_t i { 0 }; i < probes.size(); ++i) {
+		cv::Point2f interpolated = Undistort(probes[i]);
+		double error_x = (interpolated.x - exact_points[i].x) * focal_x;
+		double error_y = (interpolated.y - exact_points[i].y) * focal_y;
+		max_interpolation_error_ = std::max(max_interpolation_error_, std::sqrt(error_x * error_x + error_y * error_y));
+	}
+}
+
+void UndistortionLut::Undistort(const cv::Point2f* src, cv::Point2f* dst, size_t point_count) const
+{
+	for (size_t i { 0 }; i < point_count; ++i) {
+		dst[i] = Undistort(src[i]);
+	}
+}
+
+
+} // namespace camera_calibration
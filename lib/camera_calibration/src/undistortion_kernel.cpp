@@ -0,0 +1,248 @@
+#include <cmath>
+
+#include "camera_calibration/undistortion_kernel.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CAMERA_CALIBRATION_HAS_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CAMERA_CALIBRATION_HAS_AVX2
+#endif
+
+namespace camera_calibration {
+
+
+namespace {
+
+struct KernelConstants
+{
+	float inverse_fx, inverse_fy, cx, cy;
+	float k1, k2, p1, p2, k3, k4, k5, k6;
+};
+
+KernelConstants GetKernelConstants(const RationalDistortionModel& model)
+{
+	return KernelConstants {
+		1.0f / model.fx, 1.0f / model.fy, model.cx, model.cy,
+		model.k1, model.k2, model.p1, model.p2, model.k3, model.k4, model.k5, model.k6 };
+}
+
+void UndistortPointsScalar(
+	const KernelConstants& c, const float* src, float* dst, size_t point_count, int iteration_count, float epsilon)
+{
+	for (size_t i { 0 }; i < point_count; ++i) {
+		const float x0 = (src[2 * i] - c.cx) * c.inverse_fx;
+		const float y0 = (src[2 * i + 1] - c.cy) * c.inverse_fy;
+		float x = x0;
+		float y = y0;
+
+		for (int iteration { 0 }; iteration < iteration_count; ++iteration) {
+			float r2 = x * x + y * y;
+			float icdist = (1.0f + ((c.k6 * r2 + c.k5) * r2 + c.k4) * r2) / (1.0f + ((c.k3 * r2 + c.k2) * r2 + c.k1) * r2);
+			if (icdist < 0.0f) {
+				x = x0;
+				y = y0;
+				break;
+			}
+
+			float delta_x = 2.0f * c.p1 * x * y + c.p2 * (r2 + 2.0f * x * x);
+			float delta_y = c.p1 * (r2 + 2.0f * y * y) + 2.0f * c.p2 * x * y;
+			float next_x = (x0 - delta_x) * icdist;
+			float next_y = (y0 - delta_y) * icdist;
+			bool converged = std::fabs(next_x - x) <= epsilon && std::fabs(next_y - y) <= epsilon;
+			x = next_x;
+			y = next_y;
+			if (epsilon > 0.0f && converged) {
+				break;
+			}
+		}
+
+		dst[2 * i] = x;
+		dst[2 * i + 1] = y;
+	}
+}
+
+#ifdef CAMERA_CALIBRATION_HAS_SSE2
+
+void UndistortPointsSse2(
+	const KernelConstants& c, const float* src, float* dst, size_t point_count, int iteration_count, float epsilon)
+{
+	const size_t kWidth { 4 };
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 epsilon_v = _mm_set1_ps(epsilon);
+	const __m128 k1 = _mm_set1_ps(c.k1), k2 = _mm_set1_ps(c.k2), k3 = _mm_set1_ps(c.k3);
+	const __m128 k4 = _mm_set1_ps(c.k4), k5 = _mm_set1_ps(c.k5), k6 = _mm_set1_ps(c.k6);
+	const __m128 p1 = _mm_set1_ps(c.p1), p2 = _mm_set1_ps(c.p2);
+
+	size_t i { 0 };
+	for (; i + kWidth <= point_count; i += kWidth) {
+		// (x0 y0 x1 y1), (x2 y2 x3 y3) -> (x0 x1 x2 x3), (y0 y1 y2 y3)
+		__m128 low = _mm_loadu_ps(src + 2 * i);
+		__m128 high = _mm_loadu_ps(src + 2 * i + 4);
+		__m128 u = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 v = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+
+		const __m128 x0 = _mm_mul_ps(_mm_sub_ps(u, _mm_set1_ps(c.cx)), _mm_set1_ps(c.inverse_fx));
+		const __m128 y0 = _mm_mul_ps(_mm_sub_ps(v, _mm_set1_ps(c.cy)), _mm_set1_ps(c.inverse_fy));
+		__m128 x = x0;
+		__m128 y = y0;
+		__m128 invalid = zero;
+
+		for (int iteration { 0 }; iteration < iteration_count; ++iteration) {
+			__m128 r2 = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+			__m128 numerator = _mm_add_ps(one, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(k6, r2), k5), r2), k4), r2));
+			__m128 denominator = _mm_add_ps(one, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(k3, r2), k2), r2), k1), r2));
+			__m128 icdist = _mm_div_ps(numerator, denominator);
+			invalid = _mm_or_ps(invalid, _mm_cmplt_ps(icdist, zero));
+
+			__m128 xy = _mm_mul_ps(x, y);
+			__m128 delta_x = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(two, p1), xy), _mm_mul_ps(p2, _mm_add_ps(r2, _mm_mul_ps(two, _mm_mul_ps(x, x)))));
+			__m128 delta_y = _mm_add_ps(_mm_mul_ps(p1, _mm_add_ps(r2, _mm_mul_ps(two, _mm_mul_ps(y, y)))), _mm_mul_ps(_mm_mul_ps(two, p2), xy));
+			__m128 next_x = _mm_mul_ps(_mm_sub_ps(x0, delta_x), icdist);
+			__m128 next_y = _mm_mul_ps(_mm_sub_ps(y0, delta_y), icdist);
+			next_x = _mm_or_ps(_mm_and_ps(invalid, x0), _mm_andnot_ps(invalid, next_x));
+			next_y = _mm_or_ps(_mm_and_ps(invalid, y0), _mm_andnot_ps(invalid, next_y));
+
+			__m128 change = _mm_max_ps(
+				_mm_and_ps(_mm_sub_ps(next_x, x), abs_mask),
+				_mm_and_ps(_mm_sub_ps(next_y, y), abs_mask));
+			x = next_x;
+			y = next_y;
+			if (epsilon > 0.0f && _mm_movemask_ps(_mm_cmpgt_ps(change, epsilon_v)) == 0) {
+				break;
+			}
+		}
+
+		_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(x, y));
+		_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(x, y));
+	}
+
+	UndistortPointsScalar(c, src + 2 * i, dst + 2 * i, point_count - i, iteration_count, epsilon);
+}
+
+#endif
+
+#ifdef CAMERA_CALIBRATION_HAS_AVX2
+
+__attribute__((target("avx2,fma")))
+void UndistortPointsAvx2(
+	const KernelConstants& c, const float* src, float* dst, size_t point_count, int iteration_count, float epsilon)
+{
+	const size_t kWidth { 8 };
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 epsilon_v = _mm256_set1_ps(epsilon);
+	const __m256 k1 = _mm256_set1_ps(c.k1), k2 = _mm256_set1_ps(c.k2), k3 = _mm256_set1_ps(c.k3);
+	const __m256 k4 = _mm256_set1_ps(c.k4), k5 = _mm256_set1_ps(c.k5), k6 = _mm256_set1_ps(c.k6);
+	const __m256 two_p1 = _mm256_set1_ps(2.0f * c.p1), two_p2 = _mm256_set1_ps(2.0f * c.p2);
+	const __m256 p1 = _mm256_set1_ps(c.p1), p2 = _mm256_set1_ps(c.p2);
+	const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const __m256i interleave = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	size_t i { 0 };
+	for (; i + kWidth <= point_count; i += kWidth) {
+		// Each 256-bit load holds 4 points; permute to (x x x x y y y y) and split.
+		__m256 low = _mm256_permutevar8x32_ps(_mm256_loadu_ps(src + 2 * i), deinterleave);
+		__m256 high = _mm256_permutevar8x32_ps(_mm256_loadu_ps(src + 2 * i + 8), deinterleave);
+		__m256 u = _mm256_permute2f128_ps(low, high, 0x20);
+		__m256 v = _mm256_permute2f128_ps(low, high, 0x31);
+
+		const __m256 x0 = _mm256_mul_ps(_mm256_sub_ps(u, _mm256_set1_ps(c.cx)), _mm256_set1_ps(c.inverse_fx));
+		const __m256 y0 = _mm256_mul_ps(_mm256_sub_ps(v, _mm256_set1_ps(c.cy)), _mm256_set1_ps(c.inverse_fy));
+		__m256 x = x0;
+		__m256 y = y0;
+		__m256 invalid = zero;
+
+		for (int iteration { 0 }; iteration < iteration_count; ++iteration) {
+			__m256 r2 = _mm256_fmadd_ps(x, x, _mm256_mul_ps(y, y));
+			__m256 numerator = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(k6, r2, k5), r2, k4), r2, one);
+			__m256 denominator = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(k3, r2, k2), r2, k1), r2, one);
+			__m256 icdist = _mm256_div_ps(numerator, denominator);
+			invalid = _mm256_or_ps(invalid, _mm256_cmp_ps(icdist, zero, _CMP_LT_OQ));
+
+			__m256 xy = _mm256_mul_ps(x, y);
+			__m256 delta_x = _mm256_fmadd_ps(two_p1, xy, _mm256_mul_ps(p2, _mm256_fmadd_ps(two, _mm256_mul_ps(x, x), r2)));
+			__m256 delta_y = _mm256_fmadd_ps(p1, _mm256_fmadd_ps(two, _mm256_mul_ps(y, y), r2), _mm256_mul_ps(two_p2, xy));
+			__m256 next_x = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(x0, delta_x), icdist), x0, invalid);
+			__m256 next_y = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(y0, delta_y), icdist), y0, invalid);
+
+			__m256 change = _mm256_max_ps(
+				_mm256_and_ps(_mm256_sub_ps(next_x, x), abs_mask),
+				_mm256_and_ps(_mm256_sub_ps(next_y, y), abs_mask));
+			x = next_x;
+			y = next_y;
+			if (epsilon > 0.0f && _mm256_movemask_ps(_mm256_cmp_ps(change, epsilon_v, _CMP_GT_OQ)) == 0) {
+				break;
+			}
+		}
+
+		// (x0..x3 | y0..y3) -> (x0 y0 x1 y1 | x2 y2 x3 y3), same for the upper half.
+		__m256 first = _mm256_permute2f128_ps(x, y, 0x20);
+		__m256 second = _mm256_permute2f128_ps(x, y, 0x31);
+		_mm256_storeu_ps(dst + 2 * i, _mm256_permutevar8x32_ps(first, interleave));
+		_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permutevar8x32_ps(second, interleave));
+	}
+
+	UndistortPointsScalar(c, src + 2 * i, dst + 2 * i, point_count - i, iteration_count, epsilon);
+}
+
+#endif
+
+typedef void (*UndistortionKernel)(const KernelConstants&, const float*, float*, size_t, int, float);
+
+struct KernelChoice
+{
+	UndistortionKernel kernel;
+	const char* name;
+};
+
+KernelChoice ChooseKernel()
+{
+#ifdef CAMERA_CALIBRATION_HAS_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return KernelChoice { UndistortPointsAvx2, "avx2" };
+	}
+#endif
+#ifdef CAMERA_CALIBRATION_HAS_SSE2
+	return KernelChoice { UndistortPointsSse2, "sse2" };
+#else
+	return KernelChoice { UndistortPointsScalar, "scalar" };
+#endif
+}
+
+const KernelChoice& GetKernelChoice()
+{
+	static const KernelChoice kernel_choice = ChooseKernel();
+	return kernel_choice;
+}
+
+} // namespace
+
+
+void UndistortPointsVectorized(
+	const RationalDistortionModel& model,
+	const float* src,
+	float* dst,
+	size_t point_count,
+	int iteration_count,
+	float epsilon)
+{
+	GetKernelChoice().kernel(GetKernelConstants(model), src, dst, point_count, iteration_count, epsilon);
+}
+
+const char* GetUndistortionKernelName()
+{
+	return GetKernelChoice().name;
+}
+
+
+} // namespace camera_calibration
@@ -1,13 +1,21 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <memory>
+#include <algorithm>
 
 #include <opencv2/core/utility.hpp>
 #include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "nlohmann/json.hpp"
 
 #include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/image_ingest.h"
+#include "camera_calibration/chessboard_detection.h"
+#include "camera_calibration/detection_cache.h"
+#include "camera_calibration/async_detector.h"
+#include "camera_calibration/stream_capture.h"
 
 #include "secondary_structures_and_literals.h"
 
@@ -91,61 +99,74 @@ int main(int argc, char* argv[])
     }
 
     
-    std::vector<cv::Mat> calibration_images;
+    camera_calibration::CameraCalibration calibration(settings);
     std::vector<cv::String> calibration_image_names(required_minimum_image_number);
     cv::String image_source_type { settings.GetImageSourceType() };
     cv::String image_source_path { settings.GetImageSourcePath() };
-    int calibration_image_count { 0 };
     bool do_calibration { false };
 
     if (image_source_type == "stream") {
-        cv::VideoCapture cap;
+        camera_calibration::StreamCapture capture;
         cv::namedWindow(kMainWindowName);
 
+        bool capture_opened { false };
         try {
-            cap.open(image_source_path);
+            capture_opened = capture.Open(image_source_path);
         }
         catch(const std::exception& excpt) {
+            capture_opened = false;
+        }
+        if (!capture_opened) {
             std::cout << " - Unable to open specified image source." << std::endl;
             std::cout << " - Session ended." << std::endl;
             return ExitStatus::FAILURE;
         }
 
         bool stop_stream { false };
-        bool pattern_found { false };
+        uint64_t frame_id { 0 };
+        // Detection runs on its own thread so the preview rate does not depend on it;
+        // each frame is drawn with the latest finished detection.
+        camera_calibration::AsyncChessboardDetector detector(settings);
+        camera_calibration::AsyncChessboardDetector::Result detection;
 
         while (!stop_stream) {
             cv::Mat image;
             cv::Mat draw_image;
-            std::vector<cv::Vec2f> found_points;
             
-            if (!cap.read(image)) {
+            // A stalled stream times out here; the window keeps the last frame and the
+            // keys below keep working until frames arrive again.
+            bool frame_read = capture.Read(image, 1000 / kFPS);
+            if (!frame_read && !capture.IsRunning()) {
                 std::cout << " - Unable to read image from source." << std::endl;
                 std::cout << " - Session ended." << std::endl;
                 return ExitStatus::FAILURE;
             }
             
-            pattern_found = cv::findChessboardCorners(image, 
-                    settings.GetCalibrationBoardSize(), 
-                    found_points, cv::CALIB_CB_ADAPTIVE_THRESH | cv::CALIB_CB_NORMALIZE_IMAGE);
-            
-            if (pattern_found) {
-                image.copyTo(draw_image);
-                cv::drawChessboardCorners(draw_image, settings.GetCalibrationBoardSize(), 
-                    found_points, pattern_found);
-                cv::imshow(kMainWindowName, draw_image);
-            } else {
-                cv::imshow(kMainWindowName, image);
+            if (frame_read) {
+                detector.Submit(image, frame_id++);
+                detector.GetLatestResult(detection);
+                
+                if (detection.pattern_found) {
+                    image.copyTo(draw_image);
+                    cv::drawChessboardCorners(draw_image, settings.GetCalibrationBoardSize(), 
+                        detection.corners, detection.pattern_found);
+                    cv::imshow(kMainWindowName, draw_image);
+                } else {
+                    cv::imshow(kMainWindowName, image);
+                }
             }
 
             char key = cv::waitKey(1000 / kFPS);
             switch (key) {
             case Button::SPACE :
-                if (pattern_found) {
-                    calibration_images.push_back(image.clone());
-                    ++calibration_image_count;
+                if (detection.pattern_found) {
+                    std::vector<cv::Point2f> found_points = detection.corners;
+                    camera_calibration::RefineChessboardCorners(
+                        detection.image_gray, settings, found_points, settings.GetThreadCount());
+                    calibration.AddDetections(found_points, detection.image_gray.size());
                     std::cout << " - Calibration image has been accepted [calibration image number: " << 
-                        calibration_image_count << "]." << std::endl;
+                        calibration.GetViewCount() << ", coverage: " << 
+                        static_cast<int>(calibration.GetCoverage() * 100) << "%]." << std::endl;
                 } 
                 else {
                     std::cout << " - Unable to accept image - pattern was not found. " << std::endl;
@@ -153,7 +174,7 @@ int main(int argc, char* argv[])
                 break;
 
             case Button::ENTER :
-                if (calibration_image_count >= required_minimum_image_number) {
+                if (calibration.GetViewCount() >= required_minimum_image_number) {
                     stop_stream = true;
                     do_calibration = true;
                 }
@@ -168,6 +189,14 @@ int main(int argc, char* argv[])
                 break;
             }
         }
+
+        std::cout << " - Stream frames: " << capture.GetGrabbedFrameCount() << " grabbed, " << 
+            capture.GetDroppedFrameCount() << " dropped." << std::endl;
+        std::cout << " - Detection: " << detector.GetProcessedFrameCount() << " frames processed, " << 
+            detector.GetTrackedFrameCount() << " tracked, " << 
+            detector.GetRegionDetectedFrameCount() << " found in board region, " << 
+            detector.GetRejectedFrameCount() << " rejected by quality filter, " << 
+            detector.GetDuplicateFrameCount() << " duplicates." << std::endl;
     }
     else {
         try {
@@ -179,13 +208,63 @@ int main(int argc, char* argv[])
                 return ExitStatus::FAILURE;
             }
 
-            for (int i { 0 }; i < calibration_image_names.size(); ++i) {
-                cv::Mat image = cv::imread(calibration_image_names[i]);
-                calibration_images.push_back(image.clone());
+            std::unique_ptr<camera_calibration::DetectionCache> detection_cache;
+            if (settings.GetUseDetectionCache()) {
+                std::string detection_cache_file_path =
+                    camera_calibration::DetectionCache::GetDefaultFilePath(image_source_path);
+                calibration_image_names.erase(
+                    std::remove(calibration_image_names.begin(), calibration_image_names.end(), detection_cache_file_path),
+                    calibration_image_names.end());
+                detection_cache.reset(new camera_calibration::DetectionCache(detection_cache_file_path, settings));
+                detection_cache->LoadFromFile();
+            }
+
+            camera_calibration::ChessboardDetections calibration_detections = 
+                camera_calibration::DirectoryImageIngest(settings).Run(calibration_image_names, detection_cache.get());
+
+            if (detection_cache) {
+                std::cout << " - Detection cache: " << detection_cache->GetHitCount() << " hits, " << 
+                    detection_cache->GetMissCount() << " misses." << std::endl;
+                if (!detection_cache->SaveToFile()) {
+                    std::cout << " - Unable to save detection cache." << std::endl;
+                }
+            }
+            calibration.AddDetections(calibration_detections.corners, calibration_detections.image_size);
+            std::cout << " - Calibration pattern has been found on " << calibration.GetViewCount() << 
+                " of " << calibration_image_names.size() << " images." << std::endl;
+            std::cout << " - Detection stages:";
+            for (camera_calibration::DetectionStage stage : settings.GetDetectionCascade()) {
+                if (stage != camera_calibration::DetectionStage::FAST_CHECK) {
+                    std::cout << ' ' << camera_calibration::GetDetectionStageName(stage) << ' ' << 
+                        std::count(calibration_detections.detection_stages.begin(), 
+                            calibration_detections.detection_stages.end(), stage);
+                }
+            }
+            std::cout << '.' << std::endl;
+            if (!calibration_detections.rejected_image_names.empty()) {
+                std::cout << " - Quality filter rejected " << calibration_detections.rejected_image_names.size() << 
+                    " images:" << std::endl;
+                for (size_t i { 0 }; i < calibration_detections.rejected_image_names.size(); ++i) {
+                    std::cout << "   " << calibration_detections.rejected_image_names[i] << " (" << 
+                        camera_calibration::GetImageQualityIssueName(calibration_detections.rejection_reasons[i]) << 
+                        ")." << std::endl;
+                }
             }
+
+            if (calibration.GetViewCount() < required_minimum_image_number) {
+                std::cout << " - Insufficient number of calibration images. Required number: " << 
+                        required_minimum_image_number << '.' << std::endl;
+                return ExitStatus::FAILURE;
+            }
+            do_calibration = true;
+        }
+        catch(const camera_calibration::CameraCalibrationExeption& excpt) {
+            std::cout << excpt.what() << std::endl << std::endl;
+            std::cout << " - Session ended." << std::endl;
+            return ExitStatus::FAILURE;
         }
         catch(const std::exception& excpt) {
-            std::cout << " - Unable to open specified image source." << std::endl;
+            std::cout << " - Unable to process calibration images: " << excpt.what() << std::endl;
             std::cout << " - Session ended." << std::endl;
             return ExitStatus::FAILURE;
         }
@@ -194,8 +273,7 @@ int main(int argc, char* argv[])
 
     if (do_calibration) {
         std::cout << " - Camera calibration has started. " << std::endl;
-        camera_calibration::CameraCalibration(settings, calibration_images).
-            ExtractCameraParameters().SaveToFile(settings.GetCameraParametersFilePath());
+        calibration.Solve().SaveToFile(settings.GetCameraParametersFilePath(), settings.GetCameraParametersFileFormat());
         std::cout << " - Camera calibration has been completed. " << std::endl;
         std::cout << " - Calibration parameters saved to: " << settings.GetCameraParametersFilePath() << std::endl;
     }
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/undistortion.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+double GetMaxRelativeDifference(const cv::Mat& mat, const cv::Mat& expected_mat)
+{
+	if (mat.size() != expected_mat.size()) {
+		return 1.0;
+	}
+	double max_difference { 0.0 };
+	for (int row = 0; row < mat.rows; ++row) {
+		for (int col = 0; col < mat.cols; ++col) {
+			double expected { expected_mat.at<double>(row, col) };
+			double difference { std::abs(mat.at<double>(row, col) - expected) };
+			max_difference = std::max(max_difference, difference / std::max(std::abs(expected), 1e-12));
+		}
+	}
+	return max_difference;
+}
+
+
+CameraParameters MakeCalibratedCameraParameters()
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters(true) };
+
+	std::vector<cv::Mat> rotation_vectors;
+	std::vector<cv::Mat> translation_vectors;
+	for (int view = 0; view < 3; ++view) {
+		cv::Mat rotation_vector { cv::Mat::zeros(3, 1, CV_64F) };
+		cv::Mat translation_vector { cv::Mat::zeros(3, 1, CV_64F) };
+		rotation_vector.at<double>(0) = 0.1 * view - 0.05;
+		rotation_vector.at<double>(1) = -0.2 + 0.07 * view;
+		rotation_vector.at<double>(2) = 0.013 * view;
+		translation_vector.at<double>(0) = -0.1 + 0.02 * view;
+		translation_vector.at<double>(1) = 0.05;
+		translation_vector.at<double>(2) = 0.5 + 0.1 * view;
+		rotation_vectors.push_back(rotation_vector);
+		translation_vectors.push_back(translation_vector);
+	}
+	camera_parameters.SetRotationVectors(rotation_vectors);
+	camera_parameters.SetTranslationVectors(translation_vectors);
+	camera_parameters.SetReprojectionError(0.123456789);
+	FitInverseDistortionModel(camera_parameters, kTestImageSize);
+
+	return camera_parameters;
+}
+
+
+void TestCameraParametersBinaryRoundTrip()
+{
+	const std::string filename { "camera_parameters_test.bin" };
+	CameraParameters camera_parameters { MakeCalibratedCameraParameters() };
+	CHECK(camera_parameters.SaveToFile(filename, CameraParametersFileFormat::BINARY));
+
+	CameraParameters loaded_parameters;
+	CHECK(loaded_parameters.LoadFromFile(filename));
+	CHECK(IsSameMat(loaded_parameters.GetCameraMatrix(), camera_parameters.GetCameraMatrix()));
+	CHECK(IsSameMat(loaded_parameters.GetDistrotionCoefficients(), camera_parameters.GetDistrotionCoefficients()));
+	CHECK(IsSameMat(loaded_parameters.GetInverseDistortionCoefficients(), camera_parameters.GetInverseDistortionCoefficients()));
+	CHECK(loaded_parameters.GetImageSize() == camera_parameters.GetImageSize());
+	CHECK(loaded_parameters.GetReprojectionError() == camera_parameters.GetReprojectionError());
+	CHECK(loaded_parameters.GetInverseDistortionMaxError() == camera_parameters.GetInverseDistortionMaxError());
+	CHECK(loaded_parameters.GetInverseDistortionRmsError() == camera_parameters.GetInverseDistortionRmsError());
+
+	std::vector<cv::Mat> rotation_vectors { camera_parameters.GetRotationVectors() };
+	std::vector<cv::Mat> translation_vectors { camera_parameters.GetTranslationVectors() };
+	std::vector<cv::Mat> loaded_rotation_vectors { loaded_parameters.GetRotationVectors() };
+	std::vector<cv::Mat> loaded_translation_vectors { loaded_parameters.GetTranslationVectors() };
+	CHECK(loaded_rotation_vectors.size() == rotation_vectors.size());
+	CHECK(loaded_translation_vectors.size() == translation_vectors.size());
+	for (size_t view = 0; view < std::min(rotation_vectors.size(), loaded_rotation_vectors.size()); ++view) {
+		CHECK(IsSameMat(loaded_rotation_vectors[view], rotation_vectors[view]));
+	}
+	for (size_t view = 0; view < std::min(translation_vectors.size(), loaded_translation_vectors.size()); ++view) {
+		CHECK(IsSameMat(loaded_translation_vectors[view], translation_vectors[view]));
+	}
+
+	// A truncated binary file is rejected, not parsed as a text file.
+	const std::string truncated_filename { "camera_parameters_test_truncated.bin" };
+	TruncateFile(filename, truncated_filename, GetFileSize(filename) - 8);
+	CameraParameters truncated_parameters;
+	CHECK(!truncated_parameters.LoadFromFile(truncated_filename));
+
+	// Parameters without an inverse distortion model load without one.
+	CameraParameters plain_parameters { MakeTestCameraParameters() };
+	CHECK(plain_parameters.SaveToFile(filename, CameraParametersFileFormat::BINARY));
+	CameraParameters loaded_plain_parameters;
+	CHECK(loaded_plain_parameters.LoadFromFile(filename));
+	CHECK(IsSameMat(loaded_plain_parameters.GetDistrotionCoefficients(), plain_parameters.GetDistrotionCoefficients()));
+	CHECK(loaded_plain_parameters.GetInverseDistortionCoefficients().empty());
+
+	std::remove(filename.c_str());
+	std::remove(truncated_filename.c_str());
+}
+
+
+void TestCameraParametersTextRoundTrip()
+{
+	const std::string filename { "camera_parameters_test.txt" };
+	CameraParameters camera_parameters { MakeCalibratedCameraParameters() };
+	CHECK(camera_parameters.SaveToFile(filename, CameraParametersFileFormat::TEXT));
+
+	// The text format keeps the stream's default precision of 6 significant digits.
+	const double kTolerance { 1e-5 };
+	CameraParameters loaded_parameters;
+	CHECK(loaded_parameters.LoadFromFile(filename));
+	CHECK_LE(GetMaxRelativeDifference(loaded_parameters.GetCameraMatrix(), camera_parameters.GetCameraMatrix()), kTolerance);
+	CHECK_LE(GetMaxRelativeDifference(loaded_parameters.GetDistrotionCoefficients(), camera_parameters.GetDistrotionCoefficients()), kTolerance);
+	CHECK_LE(GetMaxRelativeDifference(loaded_parameters.GetInverseDistortionCoefficients(), camera_parameters.GetInverseDistortionCoefficients()), kTolerance);
+	CHECK_NEAR(loaded_parameters.GetInverseDistortionMaxError(), camera_parameters.GetInverseDistortionMaxError(),
+		kTolerance * camera_parameters.GetInverseDistortionMaxError());
+
+	std::remove(filename.c_str());
+}
+
+
+} // namespace
+
+
+int main()
+{
+	RunTest("camera parameters binary round trip", TestCameraParametersBinaryRoundTrip);
+	RunTest("camera parameters text round trip", TestCameraParametersTextRoundTrip);
+
+	return GetExitCode();
+}
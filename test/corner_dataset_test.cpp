@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/corner_dataset.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+CornerDataset MakeCornerDataset()
+{
+	CornerDataset dataset;
+
+	std::vector<cv::Point2f> corners { MakePixelGrid(cv::Size(90, 60), 10.0f) };
+	dataset.AddView(corners);
+
+	std::vector<cv::Point2f> partial_corners;
+	std::vector<int32_t> board_indices;
+	std::vector<float> weights;
+	for (int i = 0; i < 17; ++i) {
+		partial_corners.emplace_back(100.25f + 3.5f * i, 40.75f - 1.5f * i);
+		board_indices.push_back(3 * i + 1);
+		weights.push_back(0.5f + 0.03125f * i);
+	}
+	dataset.AddView(partial_corners.data(), partial_corners.size(), board_indices.data(), weights.data());
+	dataset.AddView(std::vector<cv::Point2f>());
+
+	dataset.SetValid(3, false);
+	dataset.SetValid(dataset.GetViewBegin(1) + 5, false);
+	dataset.SetCorner(7, cv::Point2f(-1.5f, 1e6f));
+	dataset.SetWeight(8, 2.0f);
+	return dataset;
+}
+
+
+void TestCornerDatasetRoundTrip()
+{
+	CornerDataset dataset { MakeCornerDataset() };
+	std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+	CHECK(dataset.WriteTo(stream));
+
+	CornerDataset loaded_dataset;
+	loaded_dataset.AddView(std::vector<cv::Point2f>(4, cv::Point2f(1.0f, 2.0f)));
+	CHECK(loaded_dataset.ReadFrom(stream));
+	CHECK(loaded_dataset.GetViewCount() == dataset.GetViewCount());
+	CHECK(loaded_dataset.GetCornerCount() == dataset.GetCornerCount());
+	if (loaded_dataset.GetViewCount() != dataset.GetViewCount() || loaded_dataset.GetCornerCount() != dataset.GetCornerCount()) {
+		return;
+	}
+
+	for (size_t view = 0; view < dataset.GetViewCount(); ++view) {
+		CHECK(loaded_dataset.GetViewBegin(view) == dataset.GetViewBegin(view));
+		CHECK(loaded_dataset.GetViewEnd(view) == dataset.GetViewEnd(view));
+	}
+	for (size_t index = 0; index < dataset.GetCornerCount(); ++index) {
+		CHECK(loaded_dataset.GetCorner(index) == dataset.GetCorner(index));
+		CHECK(loaded_dataset.GetWeight(index) == dataset.GetWeight(index));
+		CHECK(loaded_dataset.GetBoardIndex(index) == dataset.GetBoardIndex(index));
+		CHECK(loaded_dataset.IsValid(index) == dataset.IsValid(index));
+	}
+
+	std::string content { stream.str() };
+	std::stringstream truncated_stream(content.substr(0, content.size() - 1), std::ios::in | std::ios::binary);
+	CornerDataset truncated_dataset;
+	CHECK(!truncated_dataset.ReadFrom(truncated_stream));
+}
+
+
+} // namespace
+
+
+int main()
+{
+	RunTest("corner dataset round trip", TestCornerDatasetRoundTrip);
+
+	return GetExitCode();
+}
@@ -0,0 +1,167 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "camera_calibration/corner_refinement.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+// Documented bound on the difference to cv::cornerSubPix (see corner_refinement.h).
+const double kRefinementTolerance { 1e-3 };
+const cv::Size kCanvasSize { 1280, 960 };
+const int kBoardMargin { 60 };
+
+
+struct BoardImage
+{
+	std::string name;
+	cv::Mat image;
+	cv::Size board_size;
+};
+
+
+// Perspective views of the board: the source image corners are mapped to the given
+// canvas corners (top left, top right, bottom right, bottom left, as canvas fractions),
+// then blurred and overlaid with sensor-like noise.
+cv::Mat MakeBoardView(const cv::Mat& board_image, const std::vector<cv::Point2f>& canvas_corners, double blur_sigma, double noise_sigma)
+{
+	std::vector<cv::Point2f> source_corners {
+		cv::Point2f(0.0f, 0.0f),
+		cv::Point2f(board_image.cols - 1.0f, 0.0f),
+		cv::Point2f(board_image.cols - 1.0f, board_image.rows - 1.0f),
+		cv::Point2f(0.0f, board_image.rows - 1.0f) };
+	std::vector<cv::Point2f> target_corners;
+	for (const auto& corner : canvas_corners) {
+		target_corners.emplace_back(corner.x * (kCanvasSize.width - 1), corner.y * (kCanvasSize.height - 1));
+	}
+
+	cv::Mat view;
+	cv::warpPerspective(board_image, view, cv::getPerspectiveTransform(source_corners, target_corners), kCanvasSize,
+		cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(255));
+	if (blur_sigma > 0.0) {
+		cv::GaussianBlur(view, view, cv::Size(0, 0), blur_sigma);
+	}
+	if (noise_sigma > 0.0) {
+		cv::Mat noisy_view;
+		cv::Mat noise(view.size(), CV_32F);
+		cv::randn(noise, 0.0, noise_sigma);
+		view.convertTo(noisy_view, CV_32F);
+		cv::add(noisy_view, noise, noisy_view);
+		noisy_view.convertTo(view, CV_8U);
+	}
+	return view;
+}
+
+
+std::vector<BoardImage> LoadBoardImages(int argc, char** argv)
+{
+	std::vector<BoardImage> board_images;
+
+	// Own images: corner_refinement_test <columns> <rows> <image>...
+	if (argc > 3) {
+		cv::Size board_size(std::atoi(argv[1]), std::atoi(argv[2]));
+		for (int i = 3; i < argc; ++i) {
+			board_images.push_back(BoardImage { argv[i], cv::imread(argv[i], cv::IMREAD_GRAYSCALE), board_size });
+			CHECK(!board_images.back().image.empty());
+		}
+		return board_images;
+	}
+
+	const std::string pattern_path { std::string(CAMERA_CALIBRATION_SHARE_DIR) + "/chessboard_pattern.jpg" };
+	cv::Mat pattern { cv::imread(pattern_path, cv::IMREAD_GRAYSCALE) };
+	CHECK(!pattern.empty());
+	if (pattern.empty()) {
+		return board_images;
+	}
+	cv::copyMakeBorder(pattern, pattern, kBoardMargin, kBoardMargin, kBoardMargin, kBoardMargin, cv::BORDER_CONSTANT, cv::Scalar(255));
+
+	const cv::Size board_size { 9, 6 };
+	board_images.push_back(BoardImage { "pattern", pattern, board_size });
+	board_images.push_back(BoardImage { "fronto-parallel", MakeBoardView(pattern,
+		{ cv::Point2f(0.06f, 0.07f), cv::Point2f(0.94f, 0.07f), cv::Point2f(0.94f, 0.93f), cv::Point2f(0.06f, 0.93f) }, 1.0, 2.0), board_size });
+	board_images.push_back(BoardImage { "tilted left", MakeBoardView(pattern,
+		{ cv::Point2f(0.04f, 0.18f), cv::Point2f(0.92f, 0.03f), cv::Point2f(0.95f, 0.96f), cv::Point2f(0.05f, 0.80f) }, 1.2, 2.0), board_size });
+	board_images.push_back(BoardImage { "tilted forward", MakeBoardView(pattern,
+		{ cv::Point2f(0.16f, 0.05f), cv::Point2f(0.84f, 0.06f), cv::Point2f(0.97f, 0.95f), cv::Point2f(0.02f, 0.94f) }, 0.8, 3.0), board_size });
+	board_images.push_back(BoardImage { "rotated", MakeBoardView(pattern,
+		{ cv::Point2f(0.14f, 0.02f), cv::Point2f(0.98f, 0.16f), cv::Point2f(0.86f, 0.98f), cv::Point2f(0.02f, 0.84f) }, 1.5, 1.0), board_size });
+	return board_images;
+}
+
+
+void CompareWithCornerSubPix(const BoardImage& board_image)
+{
+	std::vector<cv::Point2f> detected_corners;
+	bool found { cv::findChessboardCorners(board_image.image, board_image.board_size, detected_corners,
+		cv::CALIB_CB_ADAPTIVE_THRESH + cv::CALIB_CB_NORMALIZE_IMAGE) };
+	CHECK(found);
+	if (!found) {
+		return;
+	}
+
+	// Start from the detected corners and from corners up to 1.5 px off, so the
+	// refinement runs for several iterations.
+	std::vector<cv::Point2f> perturbed_corners { detected_corners };
+	for (size_t i = 0; i < perturbed_corners.size(); ++i) {
+		perturbed_corners[i].x += 0.5f * static_cast<float>(i % 7) - 1.5f;
+		perturbed_corners[i].y += 0.75f * static_cast<float>(i % 5) - 1.5f;
+	}
+
+	const std::vector<cv::TermCriteria> criteria_list {
+		cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.001),
+		cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, 1e-5),
+		cv::TermCriteria(cv::TermCriteria::COUNT, 3, 0.0) };
+
+	for (const auto& initial_corners : { detected_corners, perturbed_corners }) {
+		for (int half_window : { 5, 7, 9, 11, 15 }) {
+			for (const cv::Size& zero_zone : { cv::Size(-1, -1), cv::Size(1, 1) }) {
+				for (const auto& criteria : criteria_list) {
+					const cv::Size window_size(half_window, half_window);
+
+					std::vector<cv::Point2f> reference_corners { initial_corners };
+					cv::cornerSubPix(board_image.image, reference_corners, window_size, zero_zone, criteria);
+
+					std::vector<cv::Point2f> corners { initial_corners };
+					RefineCornersSubPix(board_image.image, corners.data(), corners.size(), window_size, zero_zone, criteria, 1);
+					double difference { GetMaxPointDistance(corners, reference_corners) };
+					if (difference > kRefinementTolerance) {
+						std::cout << board_image.name << ": half window " << half_window << ", zero zone " << zero_zone.width
+							<< ", criteria " << criteria.maxCount << "/" << criteria.epsilon << std::endl;
+					}
+					CHECK_LE(difference, kRefinementTolerance);
+
+					std::vector<cv::Point2f> threaded_corners { initial_corners };
+					RefineCornersSubPix(board_image.image, threaded_corners.data(), threaded_corners.size(), window_size, zero_zone, criteria, 4);
+					CHECK(GetMaxPointDistance(threaded_corners, corners) == 0.0);
+				}
+			}
+		}
+	}
+}
+
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+	std::cout << "corner refinement kernel: " << GetCornerRefinementKernelName() << std::endl;
+
+	for (const auto& board_image : LoadBoardImages(argc, argv)) {
+		RunTest("RefineCornersSubPix matches cv::cornerSubPix on " + board_image.name, [&] { CompareWithCornerSubPix(board_image); });
+	}
+
+	return GetExitCode();
+}
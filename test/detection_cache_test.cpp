@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/detection_cache.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+CameraCalibrationSettings MakeDetectionSettings()
+{
+	CameraCalibrationSettings settings;
+	settings.SetCalibrationGridPattern("chessboard");
+	settings.SetCalibrationBoardSize(cv::Size(9, 6));
+	return settings;
+}
+
+
+void TestDetectionCacheRoundTrip()
+{
+	const std::string filename { "detection_cache_test.bin" };
+	std::remove(filename.c_str());
+	CameraCalibrationSettings settings { MakeDetectionSettings() };
+
+	DetectionCache::Entry found_entry;
+	found_entry.pattern_found = true;
+	found_entry.image_size = cv::Size(1280, 960);
+	found_entry.corners = MakePixelGrid(cv::Size(900, 600), 100.0f);
+	found_entry.corners.resize(54);
+	found_entry.detection_stage = DetectionStage::ADAPTIVE;
+	found_entry.image_hash = 0x0123456789abcdefULL;
+
+	DetectionCache::Entry missed_entry;
+	missed_entry.pattern_found = false;
+	missed_entry.image_size = cv::Size(640, 480);
+	missed_entry.detection_stage = DetectionStage::PLAIN;
+	missed_entry.image_hash = 0;
+
+	uint64_t found_key;
+	uint64_t missed_key;
+	uint64_t stale_key;
+	{
+		DetectionCache cache(filename, settings);
+		CHECK(!cache.LoadFromFile());
+		found_key = cache.GetKey(std::vector<uchar> { 1, 2, 3, 4 });
+		missed_key = cache.GetKey(std::vector<uchar> { 5, 6, 7 });
+		stale_key = cache.GetKey(std::vector<uchar> { 8, 9 });
+		CHECK(found_key != missed_key);
+		cache.Insert(found_key, found_entry);
+		cache.Insert(missed_key, missed_entry);
+		cache.Insert(stale_key, found_entry);
+		CHECK(cache.SaveToFile());
+	}
+
+	{
+		DetectionCache cache(filename, settings);
+		CHECK(cache.LoadFromFile());
+		CHECK(cache.GetKey(std::vector<uchar> { 1, 2, 3, 4 }) == found_key);
+
+		DetectionCache::Entry entry;
+		CHECK(cache.Find(found_key, entry));
+		CHECK(entry.pattern_found);
+		CHECK(entry.image_size == found_entry.image_size);
+		CHECK(entry.corners.size() == found_entry.corners.size());
+		CHECK(GetMaxPointDistance(entry.corners, found_entry.corners) == 0.0);
+		CHECK(entry.detection_stage == found_entry.detection_stage);
+		CHECK(entry.image_hash == found_entry.image_hash);
+
+		CHECK(cache.Find(missed_key, entry));
+		CHECK(!entry.pattern_found);
+		CHECK(entry.image_size == missed_entry.image_size);
+		CHECK(entry.corners.empty());
+		CHECK(cache.GetHitCount() == 2);
+
+		// stale_key is not looked up in this run, so saving prunes it.
+		CHECK(cache.SaveToFile());
+	}
+
+	{
+		DetectionCache cache(filename, settings);
+		CHECK(cache.LoadFromFile());
+		DetectionCache::Entry entry;
+		CHECK(cache.Find(found_key, entry));
+		CHECK(GetMaxPointDistance(entry.corners, found_entry.corners) == 0.0);
+		CHECK(cache.Find(missed_key, entry));
+		CHECK(!cache.Find(stale_key, entry));
+	}
+
+	// Settings that affect detection change every key.
+	CameraCalibrationSettings other_settings { MakeDetectionSettings() };
+	other_settings.SetCalibrationBoardSize(cv::Size(7, 5));
+	DetectionCache other_cache(filename, other_settings);
+	CHECK(other_cache.GetKey(std::vector<uchar> { 1, 2, 3, 4 }) != found_key);
+
+	const std::string truncated_filename { "detection_cache_test_truncated.bin" };
+	TruncateFile(filename, truncated_filename, GetFileSize(filename) - 4);
+	DetectionCache truncated_cache(truncated_filename, settings);
+	CHECK(!truncated_cache.LoadFromFile());
+
+	std::remove(filename.c_str());
+	std::remove(truncated_filename.c_str());
+}
+
+
+
+
+bool StartsWith(const std::string& text, const std::string& prefix)
+{
+	return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+
+void TestDetectionCacheFilePath()
+{
+	const std::string file_name { ".camera_calibration_cache.bin" };
+	CHECK(DetectionCache::GetDefaultFilePath("images") == "images/" + file_name);
+	CHECK(DetectionCache::GetDefaultFilePath("images/") == "images/" + file_name);
+	CHECK(DetectionCache::GetDefaultFilePath("") == "./" + file_name);
+
+	// Every glob pattern has its own file next to the images it matches.
+	std::string png_path { DetectionCache::GetDefaultFilePath("images/*.png") };
+	std::string jpg_path { DetectionCache::GetDefaultFilePath("images/*.jpg") };
+	CHECK(StartsWith(png_path, "images/.camera_calibration_cache_"));
+	CHECK(StartsWith(jpg_path, "images/.camera_calibration_cache_"));
+	CHECK(png_path != jpg_path);
+	CHECK(png_path != "images/" + file_name);
+	CHECK(DetectionCache::GetDefaultFilePath("images/*.png") == png_path);
+	CHECK(StartsWith(DetectionCache::GetDefaultFilePath("*.png"), "./.camera_calibration_cache_"));
+}
+
+
+} // namespace
+
+
+int main()
+{
+	RunTest("detection cache round trip", TestDetectionCacheRoundTrip);
+	RunTest("detection cache file per directory and glob pattern", TestDetectionCacheFilePath);
+
+	return GetExitCode();
+}
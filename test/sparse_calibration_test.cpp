@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/calibration_observations.h"
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/sparse_calibration.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+const cv::Size kBoardSize { 9, 6 };
+const float kSquareSize { 0.03f };
+const int kViewCount { 20 };
+const double kNoiseSigma { 0.2 };
+
+// Both solvers minimize the same reprojection error, so they have to end at the same
+// minimum up to their stopping rules.
+const double kRmsTolerance { 1e-3 };
+const double kCameraMatrixTolerance { 0.05 };
+const double kDistortionTolerance { 0.05 };
+
+
+struct SyntheticViews
+{
+	std::vector<cv::Point3f> board_points;
+	std::vector<std::vector<cv::Point3f>> object_points;
+	std::vector<std::vector<cv::Point2f>> image_points;
+};
+
+
+// Board views at varying distance and tilt projected with the test camera, plus
+// Gaussian corner noise. Views that leave the image are skipped.
+SyntheticViews MakeSyntheticViews(const CameraParameters& camera_parameters)
+{
+	SyntheticViews views;
+	for (int row = 0; row < kBoardSize.height; ++row) {
+		for (int col = 0; col < kBoardSize.width; ++col) {
+			views.board_points.emplace_back(col * kSquareSize, row * kSquareSize, 0.0f);
+		}
+	}
+
+	cv::RNG rng(20261018);
+	cv::Rect2f image_area(0.0f, 0.0f, kTestImageSize.width - 1.0f, kTestImageSize.height - 1.0f);
+	for (int attempt = 0; attempt < 10 * kViewCount && static_cast<int>(views.image_points.size()) < kViewCount; ++attempt) {
+		cv::Mat rotation_vector { cv::Mat::zeros(3, 1, CV_64F) };
+		cv::Mat translation_vector { cv::Mat::zeros(3, 1, CV_64F) };
+		rotation_vector.at<double>(0) = rng.uniform(-0.5, 0.5);
+		rotation_vector.at<double>(1) = rng.uniform(-0.5, 0.5);
+		rotation_vector.at<double>(2) = rng.uniform(-0.3, 0.3);
+		translation_vector.at<double>(2) = rng.uniform(0.45, 0.8);
+		translation_vector.at<double>(0) = rng.uniform(-0.45, 0.2) * translation_vector.at<double>(2);
+		translation_vector.at<double>(1) = rng.uniform(-0.35, 0.1) * translation_vector.at<double>(2);
+
+		std::vector<cv::Point2f> projected_points;
+		cv::projectPoints(views.board_points, rotation_vector, translation_vector, camera_parameters.GetCameraMatrix(),
+			camera_parameters.GetDistrotionCoefficients(), projected_points);
+
+		bool inside_image { true };
+		for (auto& point : projected_points) {
+			point.x += static_cast<float>(rng.gaussian(kNoiseSigma));
+			point.y += static_cast<float>(rng.gaussian(kNoiseSigma));
+			inside_image = inside_image && image_area.contains(point);
+		}
+		if (inside_image) {
+			views.object_points.push_back(views.board_points);
+			views.image_points.push_back(projected_points);
+		}
+	}
+
+	return views;
+}
+
+
+CalibrationObservations MakeObservations(const SyntheticViews& views)
+{
+	CalibrationObservations observations(views.board_points);
+	for (const auto& image_points : views.image_points) {
+		observations.AddView(image_points);
+	}
+	return observations;
+}
+
+
+// Largest pixel distance between the projections of both models over the image, which
+// unlike the coefficients themselves does not depend on how the solvers trade k1..k3.
+double GetMaxProjectionDifference(
+	const cv::Mat& camera_matrix,
+	const cv::Mat& distortion_coefficients,
+	const cv::Mat& expected_camera_matrix,
+	const cv::Mat& expected_distortion_coefficients)
+{
+	std::vector<cv::Point3f> rays;
+	for (float y = -0.6f; y <= 0.6f; y += 0.05f) {
+		for (float x = -0.8f; x <= 0.8f; x += 0.05f) {
+			rays.emplace_back(x, y, 1.0f);
+		}
+	}
+
+	cv::Mat zero_vector { cv::Mat::zeros(3, 1, CV_64F) };
+	std::vector<cv::Point2f> points;
+	std::vector<cv::Point2f> expected_points;
+	cv::projectPoints(rays, zero_vector, zero_vector, camera_matrix, distortion_coefficients, points);
+	cv::projectPoints(rays, zero_vector, zero_vector, expected_camera_matrix, expected_distortion_coefficients, expected_points);
+	return GetMaxPointDistance(points, expected_points);
+}
+
+
+void CompareWithOpenCV(int flags)
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters() };
+	SyntheticViews views { MakeSyntheticViews(camera_parameters) };
+	CHECK(views.image_points.size() == static_cast<size_t>(kViewCount));
+
+	cv::Mat camera_matrix;
+	cv::Mat distortion_coefficients;
+	std::vector<cv::Mat> rotation_vectors;
+	std::vector<cv::Mat> translation_vectors;
+	double rms { CalibrateCameraSparse(MakeObservations(views), kTestImageSize, camera_matrix, distortion_coefficients,
+		rotation_vectors, translation_vectors, 0, cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, 1e-12), flags) };
+
+	cv::Mat expected_camera_matrix;
+	cv::Mat expected_distortion_coefficients;
+	std::vector<cv::Mat> expected_rotation_vectors;
+	std::vector<cv::Mat> expected_translation_vectors;
+	double expected_rms { cv::calibrateCamera(views.object_points, views.image_points, kTestImageSize, expected_camera_matrix,
+		expected_distortion_coefficients, expected_rotation_vectors, expected_translation_vectors, flags) };
+
+	CHECK_NEAR(rms, expected_rms, kRmsTolerance);
+	CHECK_LE(rms, 2.0 * kNoiseSigma);
+	CHECK_LE(cv::norm(camera_matrix, expected_camera_matrix, cv::NORM_INF), kCameraMatrixTolerance);
+	CHECK_LE(GetMaxProjectionDifference(camera_matrix, distortion_coefficients, expected_camera_matrix, expected_distortion_coefficients),
+		kDistortionTolerance);
+	CHECK(distortion_coefficients.rows == 8 && distortion_coefficients.cols == 1);
+	if ((flags & cv::CALIB_FIX_K3) != 0) {
+		CHECK(distortion_coefficients.at<double>(4) == 0.0);
+	}
+
+	CHECK(rotation_vectors.size() == expected_rotation_vectors.size());
+	CHECK(translation_vectors.size() == expected_translation_vectors.size());
+	for (size_t view = 0; view < std::min(rotation_vectors.size(), expected_rotation_vectors.size()); ++view) {
+		CHECK_LE(cv::norm(rotation_vectors[view], expected_rotation_vectors[view], cv::NORM_INF), 1e-3);
+		CHECK_LE(cv::norm(translation_vectors[view], expected_translation_vectors[view], cv::NORM_INF),
+			1e-3 * cv::norm(expected_translation_vectors[view]));
+	}
+
+	// Both have to recover the camera the views were made with.
+	CHECK_LE(std::abs(camera_matrix.at<double>(0, 0) / camera_parameters.GetCameraMatrix().at<double>(0, 0) - 1.0), 0.01);
+	CHECK_LE(std::abs(camera_matrix.at<double>(1, 1) / camera_parameters.GetCameraMatrix().at<double>(1, 1) - 1.0), 0.01);
+}
+
+
+void TestThreadCountDoesNotChangeResult()
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters() };
+	CalibrationObservations observations { MakeObservations(MakeSyntheticViews(camera_parameters)) };
+
+	cv::Mat camera_matrix[2];
+	cv::Mat distortion_coefficients[2];
+	std::vector<cv::Mat> rotation_vectors[2];
+	std::vector<cv::Mat> translation_vectors[2];
+	double rms[2];
+	const int kThreadCounts[2] { 1, 3 };
+	for (int run = 0; run < 2; ++run) {
+		rms[run] = CalibrateCameraSparse(observations, kTestImageSize, camera_matrix[run], distortion_coefficients[run],
+			rotation_vectors[run], translation_vectors[run], kThreadCounts[run]);
+	}
+
+	// Per-view terms are summed in view order, whichever worker computed them.
+	CHECK(rms[0] == rms[1]);
+	CHECK(cv::norm(camera_matrix[0], camera_matrix[1], cv::NORM_INF) == 0.0);
+	CHECK(cv::norm(distortion_coefficients[0], distortion_coefficients[1], cv::NORM_INF) == 0.0);
+}
+
+
+} // namespace
+
+
+int main()
+{
+	RunTest("sparse calibration matches cv::calibrateCamera", [] { CompareWithOpenCV(0); });
+	RunTest("sparse calibration matches cv::calibrateCamera with CALIB_FIX_K3", [] { CompareWithOpenCV(cv::CALIB_FIX_K3); });
+	RunTest("sparse calibration does not depend on the thread count", TestThreadCountDoesNotChangeResult);
+
+	return GetExitCode();
+}
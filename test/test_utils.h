@@ -0,0 +1,186 @@
+#ifndef CAMERA_CALIBRATION_TEST_UTILS_H_
+#define CAMERA_CALIBRATION_TEST_UTILS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+
+// Minimal checks for the test executables: a failed check prints its location and the
+// compared values, the test keeps running and the executable exits with 1 at the end.
+#define CHECK(condition) \
+    camera_calibration::test::Check((condition), #condition, __FILE__, __LINE__)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+    camera_calibration::test::CheckNear((value), (expected), (tolerance), #value, __FILE__, __LINE__)
+
+#define CHECK_LE(value, bound) \
+    camera_calibration::test::CheckLessOrEqual((value), (bound), #value, __FILE__, __LINE__)
+
+namespace camera_calibration {
+namespace test {
+
+
+inline int& GetFailureCount()
+{
+    static int failure_count { 0 };
+    return failure_count;
+}
+
+
+inline void Check(bool condition, const char* expression, const char* file, int line)
+{
+    if (!condition) {
+        ++GetFailureCount();
+        std::cout << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+}
+
+
+inline void CheckNear(double value, double expected, double tolerance, const char* expression, const char* file, int line)
+{
+    if (!(std::abs(value - expected) <= tolerance)) {
+        ++GetFailureCount();
+        std::cout << file << ":" << line << ": check failed: " << expression << " = " << value
+            << ", expected " << expected << " +- " << tolerance << std::endl;
+    }
+}
+
+
+inline void CheckLessOrEqual(double value, double bound, const char* expression, const char* file, int line)
+{
+    if (!(value <= bound)) {
+        ++GetFailureCount();
+        std::cout << file << ":" << line << ": check failed: " << expression << " = " << value
+            << ", expected at most " << bound << std::endl;
+    }
+}
+
+
+// Runs one test case; an exception counts as a failure.
+inline void RunTest(const std::string& name, const std::function<void()>& test_case)
+{
+    int failure_count { GetFailureCount() };
+    try {
+        test_case();
+    }
+    catch (const std::exception& excpt) {
+        ++GetFailureCount();
+        std::cout << name << ": unexpected exception: " << excpt.what() << std::endl;
+    }
+    std::cout << (GetFailureCount() == failure_count ? "[ OK ] " : "[FAIL] ") << name << std::endl;
+}
+
+
+inline int GetExitCode()
+{
+    if (GetFailureCount() != 0) {
+        std::cout << GetFailureCount() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+const cv::Size kTestImageSize { 1280, 960 };
+
+
+// Camera with visible barrel distortion over kTestImageSize: 5 coefficients, or the
+// 8-coefficient rational model.
+inline CameraParameters MakeTestCameraParameters(bool rational_model = false)
+{
+    cv::Mat camera_matrix { cv::Mat::eye(3, 3, CV_64F) };
+    camera_matrix.at<double>(0, 0) = 910.0;
+    camera_matrix.at<double>(1, 1) = 905.0;
+    camera_matrix.at<double>(0, 2) = 645.5;
+    camera_matrix.at<double>(1, 2) = 478.25;
+
+    cv::Mat distortion_coefficients { cv::Mat::zeros(rational_model ? 8 : 5, 1, CV_64F) };
+    distortion_coefficients.at<double>(0) = rational_model ? 0.12 : -0.21;
+    distortion_coefficients.at<double>(1) = rational_model ? -0.04 : 0.06;
+    distortion_coefficients.at<double>(2) = 6e-4;
+    distortion_coefficients.at<double>(3) = -4e-4;
+    distortion_coefficients.at<double>(4) = rational_model ? 0.0 : -0.008;
+    if (rational_model) {
+        distortion_coefficients.at<double>(5) = 0.33;
+        distortion_coefficients.at<double>(6) = -0.02;
+    }
+
+    CameraParameters camera_parameters;
+    camera_parameters.SetCameraMatrix(camera_matrix);
+    camera_parameters.SetDistrotionCoefficients(distortion_coefficients);
+    camera_parameters.SetImageSize(kTestImageSize);
+    return camera_parameters;
+}
+
+
+// Pixel positions every `step` pixels over the image, the last row and column included.
+inline std::vector<cv::Point2f> MakePixelGrid(const cv::Size& image_size, float step)
+{
+    std::vector<cv::Point2f> points;
+    for (float y = 0.0f; y < image_size.height - 1; y += step) {
+        for (float x = 0.0f; x < image_size.width - 1; x += step) {
+            points.emplace_back(x, y);
+        }
+        points.emplace_back(image_size.width - 1.0f, y);
+    }
+    for (float x = 0.0f; x < image_size.width - 1; x += step) {
+        points.emplace_back(x, image_size.height - 1.0f);
+    }
+    points.emplace_back(image_size.width - 1.0f, image_size.height - 1.0f);
+    return points;
+}
+
+
+// Largest distance between corresponding points, multiplied by scale (e.g. the focal
+// length to express normalized coordinates in pixels).
+inline double GetMaxPointDistance(const std::vector<cv::Point2f>& points, const std::vector<cv::Point2f>& reference_points, double scale = 1.0)
+{
+    double max_distance { 0.0 };
+    for (size_t i = 0; i < std::min(points.size(), reference_points.size()); ++i) {
+        double dx { static_cast<double>(points[i].x) - reference_points[i].x };
+        double dy { static_cast<double>(points[i].y) - reference_points[i].y };
+        max_distance = std::max(max_distance, std::sqrt(dx * dx + dy * dy) * scale);
+    }
+    return max_distance;
+}
+
+
+inline bool IsSameMat(const cv::Mat& mat, const cv::Mat& expected_mat)
+{
+    return mat.size() == expected_mat.size() && mat.type() == expected_mat.type() &&
+        (expected_mat.empty() || cv::norm(mat, expected_mat, cv::NORM_INF) == 0.0);
+}
+
+
+inline size_t GetFileSize(const std::string& filename)
+{
+    std::ifstream fin(filename, std::ios::binary | std::ios::ate);
+    return fin.is_open() ? static_cast<size_t>(fin.tellg()) : 0;
+}
+
+
+// Copies the first `size` bytes of a file, to check that readers reject damaged files.
+inline void TruncateFile(const std::string& filename, const std::string& truncated_filename, size_t size)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    std::string content { std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>() };
+    std::ofstream fout(truncated_filename, std::ios::binary);
+    fout.write(content.data(), std::min(size, content.size()));
+}
+
+
+} // namespace test
+} // namespace camera_calibration
+
+#endif
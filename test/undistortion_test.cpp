@@ -0,0 +1,241 @@
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+
+#include "camera_calibration/camera_calibration.h"
+#include "camera_calibration/undistortion.h"
+#include "camera_calibration/undistortion_kernel.h"
+
+#include "test_utils.h"
+
+using namespace camera_calibration;
+using namespace camera_calibration::test;
+
+namespace {
+
+
+// The vectorized kernel runs the iteration of cv::undistortPoints in single precision.
+const double kVectorizedTolerance { 2e-3 };
+// Float rounding on top of the interpolation or fit error a table or model reports.
+const double kRoundingTolerance { 1e-3 };
+
+
+void TestUndistortionMapsRoundTrip()
+{
+	const std::string filename { "undistortion_maps_test.bin" };
+	const std::string truncated_filename { "undistortion_maps_test_truncated.bin" };
+	CameraParameters camera_parameters { MakeTestCameraParameters() };
+	const cv::Size image_size { 640, 480 };
+
+	for (int map_type : { CV_16SC2, CV_32FC1, CV_32FC2 }) {
+		Undistorter undistorter(camera_parameters, 1);
+		CHECK(undistorter.SaveMapsToFile(filename, image_size, 0.5, map_type));
+		std::shared_ptr<const UndistortionMaps> maps { undistorter.GetMaps(image_size, 0.5, map_type) };
+
+		Undistorter loading_undistorter(camera_parameters, 1);
+		CHECK(loading_undistorter.LoadMapsFromFile(filename));
+		std::shared_ptr<const UndistortionMaps> loaded_maps { loading_undistorter.GetMaps(image_size, 0.5, map_type) };
+		CHECK(loaded_maps->image_size == maps->image_size);
+		CHECK(loaded_maps->alpha == maps->alpha);
+		CHECK(loaded_maps->map_type == maps->map_type);
+		CHECK(IsSameMat(loaded_maps->new_camera_matrix, maps->new_camera_matrix));
+		CHECK(IsSameMat(loaded_maps->map1, maps->map1));
+		CHECK(IsSameMat(loaded_maps->map2, maps->map2));
+
+		TruncateFile(filename, truncated_filename, GetFileSize(filename) - 2);
+		Undistorter truncated_undistorter(camera_parameters, 1);
+		CHECK(!truncated_undistorter.LoadMapsFromFile(truncated_filename));
+	}
+
+	// Maps built for other camera parameters are rejected.
+	Undistorter other_undistorter(MakeTestCameraParameters(true), 1);
+	CHECK(!other_undistorter.LoadMapsFromFile(filename));
+	CHECK(!other_undistorter.LoadMapsFromFile("missing_undistortion_maps_test.bin"));
+
+	std::remove(filename.c_str());
+	std::remove(truncated_filename.c_str());
+}
+
+
+std::vector<cv::Point2f> UndistortPointsOpenCV(const std::vector<cv::Point2f>& points, const CameraParameters& camera_parameters)
+{
+	std::vector<cv::Point2f> undistorted_points;
+	cv::undistortPoints(points, undistorted_points, camera_parameters.GetCameraMatrix(), camera_parameters.GetDistrotionCoefficients());
+	return undistorted_points;
+}
+
+
+std::vector<cv::Point2f> MakeRandomPixels(const cv::Size& image_size, int point_count)
+{
+	cv::RNG rng(0x5eed);
+	std::vector<cv::Point2f> points(point_count);
+	for (auto& point : points) {
+		point.x = rng.uniform(0.0f, image_size.width - 1.0f);
+		point.y = rng.uniform(0.0f, image_size.height - 1.0f);
+	}
+	return points;
+}
+
+
+double GetFocalLength(const CameraParameters& camera_parameters)
+{
+	return camera_parameters.GetCameraMatrix().at<double>(0, 0);
+}
+
+
+void TestUndistortionLut(bool rational_model)
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters(rational_model) };
+	std::vector<cv::Point2f> points { MakeRandomPixels(kTestImageSize, 100000) };
+	std::vector<cv::Point2f> reference_points { UndistortPointsOpenCV(points, camera_parameters) };
+	double focal_length { GetFocalLength(camera_parameters) };
+
+	for (float grid_pitch : { 1.0f, 4.0f, 8.0f, 16.0f }) {
+		UndistortionLut lut(camera_parameters, kTestImageSize, grid_pitch);
+		CHECK(lut.GetImageSize() == kTestImageSize);
+		CHECK(lut.GetGridPitch() == grid_pitch);
+		if (grid_pitch <= 8.0f) {
+			CHECK_LE(lut.GetMaxInterpolationError(), 0.05);
+		}
+
+		std::vector<cv::Point2f> undistorted_points(points.size());
+		lut.Undistort(points.data(), undistorted_points.data(), points.size());
+		CHECK_LE(GetMaxPointDistance(undistorted_points, reference_points, focal_length),
+			2.0 * lut.GetMaxInterpolationError() + kRoundingTolerance);
+
+		// Grid nodes hold exact values.
+		std::vector<cv::Point2f> node_points;
+		for (float y = 0.0f; y < kTestImageSize.height; y += grid_pitch) {
+			for (float x = 0.0f; x < kTestImageSize.width; x += grid_pitch) {
+				node_points.emplace_back(x, y);
+			}
+		}
+		std::vector<cv::Point2f> undistorted_node_points(node_points.size());
+		lut.Undistort(node_points.data(), undistorted_node_points.data(), node_points.size());
+		CHECK_LE(GetMaxPointDistance(undistorted_node_points, UndistortPointsOpenCV(node_points, camera_parameters), focal_length),
+			kRoundingTolerance);
+	}
+}
+
+
+void TestVectorizedUndistortion(bool rational_model)
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters(rational_model) };
+	std::vector<cv::Point2f> points { MakePixelGrid(kTestImageSize, 4.0f) };
+	std::vector<cv::Point2f> reference_points { UndistortPointsOpenCV(points, camera_parameters) };
+	double focal_length { GetFocalLength(camera_parameters) };
+
+	std::cout << "undistortion kernel: " << GetUndistortionKernelName() << std::endl;
+
+	std::vector<cv::Point2f> undistorted_points(points.size());
+	UndistortPointsVectorized(points.data(), undistorted_points.data(), points.size(), camera_parameters);
+	CHECK_LE(GetMaxPointDistance(undistorted_points, reference_points, focal_length), kVectorizedTolerance);
+
+	// In place, and with a point count that leaves a partial block.
+	std::vector<cv::Point2f> in_place_points(points.begin(), points.begin() + 13);
+	UndistortPointsVectorized(in_place_points.data(), in_place_points.data(), in_place_points.size(), camera_parameters);
+	CHECK(GetMaxPointDistance(in_place_points, undistorted_points) == 0.0);
+	CHECK(in_place_points.size() == 13);
+
+	// Early exit stops once no point of a block moves by more than epsilon.
+	const float kEpsilon { 1e-6f };
+	std::vector<cv::Point2f> early_exit_points(points.size());
+	UndistortPointsVectorized(points.data(), early_exit_points.data(), points.size(), camera_parameters, 5, kEpsilon);
+	CHECK_LE(GetMaxPointDistance(early_exit_points, reference_points, focal_length), kVectorizedTolerance + 10.0 * kEpsilon * focal_length);
+
+	// The library wrapper is cv::undistortPoints.
+	std::vector<cv::Point2f> wrapper_points(points.size());
+	UndistortPoints(points.data(), wrapper_points.data(), points.size(), camera_parameters);
+	CHECK(GetMaxPointDistance(wrapper_points, reference_points) == 0.0);
+}
+
+
+void TestClosedFormUndistortion(bool rational_model)
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters(rational_model) };
+	FitInverseDistortionModel(camera_parameters, kTestImageSize);
+	CHECK(camera_parameters.GetInverseDistortionCoefficients().total() == static_cast<size_t>(kInverseDistortionCoefficientCount));
+	CHECK_LE(camera_parameters.GetInverseDistortionMaxError(), 0.5);
+	CHECK_LE(camera_parameters.GetInverseDistortionRmsError(), camera_parameters.GetInverseDistortionMaxError());
+
+	// Exact ground truth: undistorted points projected with the forward model of
+	// cv::projectPoints, the iterative cv::undistortPoints is not converged at the edges.
+	std::vector<cv::Point3f> object_points;
+	for (float y = -0.7f; y <= 0.7f; y += 0.01f) {
+		for (float x = -0.9f; x <= 0.9f; x += 0.01f) {
+			object_points.emplace_back(x, y, 1.0f);
+		}
+	}
+	std::vector<cv::Point2f> projected_points;
+	cv::Mat zero_vector { cv::Mat::zeros(3, 1, CV_64F) };
+	cv::projectPoints(object_points, zero_vector, zero_vector, camera_parameters.GetCameraMatrix(),
+		camera_parameters.GetDistrotionCoefficients(), projected_points);
+
+	std::vector<cv::Point2f> points;
+	std::vector<cv::Point2f> expected_points;
+	cv::Rect2f image_area(0.0f, 0.0f, kTestImageSize.width - 1.0f, kTestImageSize.height - 1.0f);
+	for (size_t i = 0; i < projected_points.size(); ++i) {
+		if (image_area.contains(projected_points[i])) {
+			points.push_back(projected_points[i]);
+			expected_points.emplace_back(object_points[i].x, object_points[i].y);
+		}
+	}
+	CHECK(points.size() > object_points.size() / 2);
+
+	std::vector<cv::Point2f> undistorted_points(points.size());
+	UndistortPointsClosedForm(points.data(), undistorted_points.data(), points.size(), camera_parameters);
+	CHECK_LE(GetMaxPointDistance(undistorted_points, expected_points, GetFocalLength(camera_parameters)),
+		1.5 * camera_parameters.GetInverseDistortionMaxError() + kRoundingTolerance);
+}
+
+
+void TestClosedFormFallback()
+{
+	CameraParameters camera_parameters { MakeTestCameraParameters() };
+	CHECK(TryFitInverseDistortionModel(camera_parameters, kTestImageSize));
+	CHECK(!camera_parameters.GetInverseDistortionCoefficients().empty());
+
+	// Too small an image makes the fit throw; the non-throwing fit then leaves no model
+	// behind rather than the previous one.
+	bool fit_failed { false };
+	CameraParameters failed_parameters { camera_parameters };
+	try {
+		FitInverseDistortionModel(failed_parameters, cv::Size(1, 1));
+	}
+	catch (const CameraCalibrationExeption&) {
+		fit_failed = true;
+	}
+	CHECK(fit_failed);
+	CHECK(!TryFitInverseDistortionModel(failed_parameters, cv::Size(1, 1)));
+	CHECK(failed_parameters.GetInverseDistortionCoefficients().empty());
+	CHECK(failed_parameters.GetInverseDistortionMaxError() == 0.0);
+
+	// Without a model the closed form runs the iterative undistortion.
+	std::vector<cv::Point2f> points { MakePixelGrid(kTestImageSize, 16.0f) };
+	std::vector<cv::Point2f> undistorted_points(points.size());
+	UndistortPointsClosedForm(points.data(), undistorted_points.data(), points.size(), failed_parameters);
+	CHECK(GetMaxPointDistance(undistorted_points, UndistortPointsOpenCV(points, failed_parameters)) == 0.0);
+}
+
+
+} // namespace
+
+
+int main()
+{
+	RunTest("undistortion maps round trip", TestUndistortionMapsRoundTrip);
+	RunTest("undistortion lookup table matches cv::undistortPoints", [] { TestUndistortionLut(false); });
+	RunTest("undistortion lookup table matches cv::undistortPoints, rational model", [] { TestUndistortionLut(true); });
+	RunTest("vectorized undistortion matches cv::undistortPoints", [] { TestVectorizedUndistortion(false); });
+	RunTest("vectorized undistortion matches cv::undistortPoints, rational model", [] { TestVectorizedUndistortion(true); });
+	RunTest("closed-form undistortion inverts cv::projectPoints", [] { TestClosedFormUndistortion(false); });
+	RunTest("closed-form undistortion inverts cv::projectPoints, rational model", [] { TestClosedFormUndistortion(true); });
+	RunTest("closed-form undistortion falls back to the iterative path without a model", TestClosedFormFallback);
+
+	return GetExitCode();
+}